@@ -175,7 +175,8 @@ protected:
     volatile size_t pos;
     volatile size_t totalLen;
     volatile BufferType* buffer;
-    Semaphore flag;
+    /** Set while no operation is in progress. Notified by the ISR when an operation completes. */
+    Notification flag{Notification::Mode::binary, 1};
   };
   RxCallbackFn rxCbFn_;
   Config cfg_;
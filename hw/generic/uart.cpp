@@ -53,14 +53,14 @@ size_t BasicUart_Base::read(char* buffer, const size_t bufferLen)
   rx_.buffer = const_cast<char*>(buffer);
   rx_.pos = 0;
   rx_.totalLen = bufferLen;
-  rx_.flag.unlock();
+  rx_.flag.notify();
   switch(cfg_.rxBlockingMode)
   {
     //In ISR mode the hardware receive buffer is first flushed of characters. If there is still room
     //for receiving more characters, the ISR is enabled and the thread will sleep on the ISR done
     //flag for the timeout duration.
     case BlockingMode::isr:
-      rx_.flag.lock(Duration::milliseconds(0));
+      rx_.flag.clear();
       while(isRxBufferReady() && (rx_.pos < rx_.pos))
       {
         rx_.buffer[rx_.pos++] = readRxBuffer();
@@ -69,7 +69,7 @@ size_t BasicUart_Base::read(char* buffer, const size_t bufferLen)
       {
         return rx_.pos;
       }
-      //Enable the interrupt then sleep on the semaphore. Once RX ISR is finished, we should be
+      //Enable the interrupt then sleep on the notification. Once RX ISR is finished, we should be
       //woken up.
       setRxIsrEnable(true); 
       break;
@@ -96,7 +96,7 @@ size_t BasicUart_Base::read(char* buffer, const size_t bufferLen)
 
 size_t BasicUart_Base::waitForChars(const Duration& timeout)
 {
-  LockGuard grabFlag(rx_.flag, timeout);
+  rx_.flag.waitUntilSet(timeout);
   return rx_.pos;
 }
 
@@ -108,13 +108,13 @@ void BasicUart_Base::write(const char* cStr, const size_t length_chars)
   tx_.buffer = cStr;
   tx_.pos = 0;
   tx_.totalLen = length_chars;
-  tx_.flag.unlock();
+  tx_.flag.notify();
   //A switch is used here to allow easy expansion of modes in the future.
   switch(cfg_.txBlockingMode)
   {
     case BlockingMode::isr:
       //Ensure the transmit flag is cleared. This means if the isr posts it later we will see it.
-      tx_.flag.lock(Duration::milliseconds(0));
+      tx_.flag.clear();
       clearTxIsrFlags(); 
       //Load as many characters as we can into the buffer. On targets with buffering inside the
       //UART, this will work for multiple chars. Without an internal buffer this will only run once.
@@ -123,7 +123,7 @@ void BasicUart_Base::write(const char* cStr, const size_t length_chars)
         loadTxBuffer(tx_.buffer[tx_.pos++]); 
         if(tx_.pos >= tx_.totalLen) //If we loaded all the characters being transmitted, 
         { //then we can just post the done flag and return.
-          tx_.flag.unlock(); 
+          tx_.flag.notify(); 
           return;
         }
       }
@@ -158,9 +158,7 @@ void BasicUart_Base::write(const char c)
 
 bool BasicUart_Base::isBusy(const Duration& timeout) 
 {
-  LockGuard lg(tx_.flag, timeout);
-  if(lg.isLocked()) { return false; }
-  return true;
+  return tx_.flag.waitUntilSet(timeout) != Status::success;
 }
 
 void BasicUart_Base::registerRxCallback(RxCallbackFn fn, bool enableIsr)
@@ -192,7 +190,7 @@ void BasicUart_Base::isr_RxBufferFull() noexcept
           {
             rx_.buffer[rx_.totalLen] = 0;
             setRxIsrEnable(false);
-            rx_.flag.unlock();
+            rx_.flag.notify();
             return;
           }
           rx_.buffer[rx_.pos++] = readRxBuffer();
@@ -216,7 +214,7 @@ void BasicUart_Base::isr_TxBufferEmpty() noexcept
         if(tx_.pos >= tx_.totalLen)
         {
           setTxIsrEnable(false);
-          tx_.flag.unlock();
+          tx_.flag.notify();
           return;
         }
         loadTxBuffer(tx_.buffer[tx_.pos++]);
@@ -96,7 +96,7 @@ size_t BasicUart::read(char* buffer, const size_t bufferLen)
   rx_.buffer = const_cast<char*>(buffer);
   rx_.pos = 0;
   rx_.totalLen = bufferLen;
-  rx_.flag.unlock();
+  rx_.flag.notify();
   for(size_t i = 0; i < bufferLen; i++) { buffer[i] = 0; }
   switch(cfg_.rxBlockingMode)
   {
@@ -104,14 +104,14 @@ size_t BasicUart::read(char* buffer, const size_t bufferLen)
     //for receiving more characters, the ISR is enabled and the thread will sleep on the ISR done
     //flag for the timeout duration.
     case BlockingMode::isr:
-      rx_.flag.lock(Duration::milliseconds(0));
+      rx_.flag.clear();
       if(rx_.pos >= rx_.totalLen)
       {
         return rx_.pos;
       }
       HAL_UART_AbortReceive_IT(hw_->haltd);
       HAL_UART_Receive_IT(hw_->haltd, reinterpret_cast<uint8_t*>(buffer), bufferLen);
-      //Enable the interrupt then sleep on the semaphore. Once RX ISR is finished, we should be
+      //Enable the interrupt then sleep on the notification. Once RX ISR is finished, we should be
       //woken up.
       break;
     //Polling mode simply spins on the receive buffer, grabbing a timestamp after each check to see
@@ -142,8 +142,7 @@ void BasicUart::write(const char* cStr, const size_t length_chars)
       break;
     case BlockingMode::isr:
       HAL_UART_AbortTransmit_IT(hw_->haltd);
-      tx_.flag.unlock();
-      tx_.flag.lock(Duration::zero());
+      tx_.flag.clear();
       HAL_UART_Transmit_IT(hw_->haltd, reinterpret_cast<uint8_t*>(const_cast<char*>(cStr)),
         length_chars);
       break;
@@ -162,18 +161,12 @@ void BasicUart::write(const char c)
 
 bool BasicUart::isBusy(const Duration& timeout)
 {
-  auto lg = LockGuard(tx_.flag, timeout);
-  if(lg.isLocked())
-  {
-    return false;
-  }
-  return true;
+  return tx_.flag.waitUntilSet(timeout) != Status::success;
 }
 
 size_t BasicUart::waitForChars(const Duration& timeout)
 {
-  auto lg = LockGuard(rx_.flag, timeout);
-  if(lg.isLocked())
+  if(rx_.flag.waitUntilSet(timeout) == Status::success)
   {
     return rx_.pos;
   }
@@ -336,7 +329,7 @@ public:
     switch(flags)
     {
       case Flags::TX_COMPLETE:
-        uart->tx_.flag.unlock();
+        uart->tx_.flag.notify();
         break;
       case Flags::RX_COMPLETE:
         if(uart->cfg_.rxBlockingMode == BlockingMode::isr_rxCallback)
@@ -354,7 +347,7 @@ public:
           if(uart->rx_.pos >= uart->rx_.totalLen)
           {
             uart->rx_.buffer[uart->rx_.totalLen] = 0;
-            uart->rx_.flag.unlock();
+            uart->rx_.flag.notify();
             return;
           }
           uint8_t* b = reinterpret_cast<uint8_t*>(const_cast<char*>(uart->rx_.buffer));
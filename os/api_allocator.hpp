@@ -23,6 +23,13 @@
  *      size are expected. It is generally considerably faster than the system heap implementation
  *      using a linked list; large differences between object size and block size can, however,
  *      waste significant amounts of memory.
+ *      -A monotonic (arena) allocator. Allocations are a pointer bump into a fixed buffer and are
+ *      released all at once by rewinding to a Marker, making it ideal for request scoped work such
+ *      as CLI command execution.
+ *      -STL adapters. StdAllocator<T> satisfies the C++ Allocator requirements and MemoryResource
+ *      implements std::pmr::memory_resource (where the standard library provides it), both
+ *      forwarding to any AllocatorInterface. These allow STL containers to be placed in a dedicated
+ *      pool, such as a BlockAllocator or external memory, instead of the system heap.
  *
  *  @todo
  *    -Implement a specialized heap fragmentation visualizer. This will be primarily a debug tool
@@ -31,14 +38,6 @@
  *    should share a common abstracted interface that the visualizer can use to draw the in-use and
  *    free memory, as well as provide statistics on allocated and free block distributions and
  *    sizes.
- *    -Match STL allocator implementation. This will likely be done by expanding upon the
- *    AllocatorInterface class. This needs to be done to allow use of std::string/std::vector and
- *    other containers but with a custom allocator (for example, using external SDRAM memory).
- *    -Override STL/g++ exception allocation scheme. A custom/separate heap with fallback to the
- *    system one is more desirable here; this is to significantly reduce uncertainty in exception
- *    throw() times. Essentially, instead of relying on a seperate shared storage block only for
- *    fallback on OOM exceptions, rely on a threadsafe shared block normally with fallback on the
- *    system heap or system terminate(). 
  *
  *  @author Jonathan Thomson 
  */
@@ -68,16 +67,75 @@
 /** C/C++ Standard Library Headers */
 #include <memory>
 #include <atomic>
-#include <bitset>
 #include <cassert>
+#include <cstdint>
+#include <new>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
 /** jel Library Headers */
 #include "os/api_common.hpp"
 #include "os/api_time.hpp"
 #include "os/api_queues.hpp"
 
+/** When defined, every allocation and deallocation recorded through the
+ * AllocatorStatisticsInterface is also written into the AllocationTrace ring buffer, along with the
+ * calling code address, thread and time. This costs a timestamp read and roughly 32 bytes of
+ * copying per allocator call, plus the ring buffer storage, so it is disabled by default. The
+ * records can be viewed with the 'os memtrace' CLI command. */
+//#define ENABLE_ALLOCATION_TRACING
+
 namespace jel
 {
 
+class AllocatorStatisticsInterface;
+
+/** @class AllocationTrace
+ *  @brief A lock-free ring buffer of the most recent allocator calls, used to find which code is
+ *  allocating memory (for example, on a real-time path).
+ *
+ *  Records are only written when ENABLE_ALLOCATION_TRACING is defined. Writers claim a slot with a
+ *  single atomic increment and never block, so the oldest records are silently overwritten. Each
+ *  slot carries a sequence number that readers use to discard records that were being overwritten
+ *  while they were copied.
+ * */
+class AllocationTrace
+{
+public:
+  /** The number of records retained in the ring buffer. */
+  static constexpr size_t depth = 128;
+  struct Record
+  {
+    /** When the call was made. */
+    Timestamp timestamp;
+    /** The allocator that handled the call. */
+    const AllocatorStatisticsInterface* allocator;
+    /** The return address of the allocation call, i.e. the code that requested the memory. */
+    const void* callSite;
+    /** The handle of the calling thread. */
+    const void* thread;
+    /** The memory that was allocated or released. */
+    const void* ptr;
+    /** Requested (or, for deallocations, released) size in bytes, if known. */
+    size_t size_Bytes;
+    bool isAllocation;
+  };
+  /** Adds a record to the ring buffer. */
+  static void record(const AllocatorStatisticsInterface* allocator, const void* ptr, size_t size,
+    const void* callSite, bool isAllocation) noexcept;
+  /** Copies up to maxRecords of the most recent records, oldest first, into records. Returns the
+   * number of records copied. */
+  static size_t snapshot(Record* records, size_t maxRecords) noexcept;
+  /** The total number of records written since boot or the last clear(). */
+  static size_t totalRecords() noexcept { return head_.load(); }
+  /** Discards all current records. */
+  static void clear() noexcept;
+private:
+  static std::atomic<size_t> head_;
+  static std::atomic<size_t> sequence_[depth];
+  static Record ring_[depth];
+};
+
 /** @Class AllocatorStatisticsInterface
  *  @brief An optional interface that can be implemented by allocator components and is used for
  *  tracking memory usage at the system level. 
@@ -122,12 +180,28 @@ public:
   /** Returns the total size of the allocator (in bytes). If an allocator implementation can change
    * its total available size, this number may change. */
   virtual size_t totalSpace_Bytes() const noexcept = 0;
+  /** Returns the size of the largest contiguous free region within the allocator (in bytes).
+   * Allocators that do not track contiguous free space report freeSpace_Bytes(). */
+  virtual size_t largestFreeBlock_Bytes() const noexcept { return freeSpace_Bytes(); }
+  /** Returns the external fragmentation of the allocator as a percentage. This is 0 when all free
+   * space is contiguous and approaches 100 as free space is split into many small regions. */
+  size_t fragmentation_Percent() const noexcept
+  {
+    size_t fs = freeSpace_Bytes(); size_t lfb = largestFreeBlock_Bytes();
+    if(fs == 0 || lfb >= fs) { return 0; }
+    return 100 - ((lfb * 100) / fs);
+  }
   /** Returns the number of allocations that have been made by the allocator since system boot.
    * @TODO evaluate whether to move to uint64_t. */
   virtual size_t totalAllocations() const noexcept { return totalAllocations_; }
   /** Returns the number of deallocations that have been made by the allocator since system boot.
    * @TODO evaluate whether to move to uint64_t. */
   virtual size_t totalDeallocations() const noexcept { return totalDeallocations_; }
+  /** Returns the number of reallocations that were resized without moving the memory. */
+  virtual size_t totalInPlaceReallocations() const noexcept { return totalInPlaceReallocations_; }
+  /** Returns the number of reallocations that required a new allocation and a copy. These are also
+   * counted as one allocation and one deallocation. */
+  virtual size_t totalMovedReallocations() const noexcept { return totalMovedReallocations_; }
   /** Returns a null terminated C-string that indicates the name of the allocator. */
   virtual const char* name() const noexcept { return name_; }
   /** Provides a reference to the beginning of the linked list that includes all allocators
@@ -137,9 +211,32 @@ public:
 protected:
   void recordAllocation() noexcept { totalAllocations_++; };
   void recordDeallocation() noexcept { totalDeallocations_++; };
+  /** Variants that additionally write an AllocationTrace record when tracing is enabled. callSite
+   * should be the return address of the public allocation function, i.e.
+   * __builtin_return_address(0). */
+  void recordAllocation(const void* ptr, size_t size, const void* callSite) noexcept
+  {
+    totalAllocations_++;
+#ifdef ENABLE_ALLOCATION_TRACING
+    AllocationTrace::record(this, ptr, size, callSite, true);
+#endif
+  };
+  void recordDeallocation(const void* ptr, size_t size, const void* callSite) noexcept
+  {
+    totalDeallocations_++;
+#ifdef ENABLE_ALLOCATION_TRACING
+    AllocationTrace::record(this, ptr, size, callSite, false);
+#endif
+  };
+  void recordReallocation(bool inPlace) noexcept
+  {
+    if(inPlace) { totalInPlaceReallocations_++; } else { totalMovedReallocations_++; }
+  };
 private:
   std::atomic<size_t> totalAllocations_;
   std::atomic<size_t> totalDeallocations_;
+  std::atomic<size_t> totalInPlaceReallocations_;
+  std::atomic<size_t> totalMovedReallocations_;
   char name_[maxNameLength_chars];
   AllocatorsTableEntry statsTableEntry_;
   static AllocatorsTableEntry* allocatorTableStart_;
@@ -176,24 +273,218 @@ public:
   SystemAllocator& operator=(SystemAllocator&&) = delete;
   void* allocate(size_t size) override final;
   void deallocate(void* ptr) override final;
+  /** Identical to allocate()/deallocate(), but callSite is recorded as the caller when allocation
+   * tracing is enabled. Used by the operator new and malloc family wrappers so that the code
+   * calling them is traced, rather than the wrapper itself. */
+  void* allocate(size_t size, const void* callSite);
+  void deallocate(void* ptr, const void* callSite);
+  /** Resize memory previously returned by allocate(), with the semantics of realloc(). The block is
+   * shrunk or grown in place when possible; otherwise a new block is allocated, the live bytes are
+   * copied and the old block is released. A nullptr ptr is equivalent to allocate(size), and a
+   * size of zero releases ptr and returns a nullptr. Throws std::bad_alloc if a required new block
+   * cannot be allocated, in which case ptr is left untouched. */
+  void* reallocate(void* ptr, size_t size);
+  void* reallocate(void* ptr, size_t size, const void* callSite);
+  /** Returns the number of bytes usable at ptr, which may exceed the size originally requested. */
+  size_t usableSize(const void* ptr) const noexcept;
   size_t freeSpace_Bytes() const noexcept override final;
   size_t minimumFreeSpace_Bytes() const noexcept override final;
   size_t totalSpace_Bytes() const noexcept override final;
+  size_t largestFreeBlock_Bytes() const noexcept override final;
   static SystemAllocator* systemAllocator() { return systemAllocator_; }
   /** The constructSystemAllocator() function should only ever be called by the jel during startup,
    * and never the application. Repeated calls to this function will have no effect. */
   static void constructSystemAllocator() noexcept;
-  /** Attempts to allocate memory for an exception to the internal thread-safe exception page. If
-   * this fails, it will be allocated on the heap instead. */
+  /** Allocates memory for an exception from the lock-free exception pool (configured by
+   * config::exceptionPoolClasses). If every suitable block is in use, the memory is allocated from
+   * the system heap instead. Returns a nullptr only if both fail. Used by the
+   * __cxa_allocate_exception override, so throwing does not normally touch the system heap. */
   static void* allocateException(size_t size) noexcept;
   static void deallocateException(void* except) noexcept;
+  /** Number of exception allocations served by the exception pool. */
+  static size_t exceptionPoolHits() noexcept { return excpHits_.load(); }
+  /** Number of exception allocations that fell back to the system heap. */
+  static size_t exceptionPoolFallbacks() noexcept { return excpFallbacks_.load(); }
 private:
-  static constexpr size_t exceptionPageSize_bytes = 64;
-  static std::atomic<bool> excpLocked_;
-  static __attribute__((aligned(4))) uint8_t excpPage_[exceptionPageSize_bytes];
+  static std::atomic<size_t> excpHits_;
+  static std::atomic<size_t> excpFallbacks_;
   static SystemAllocator* systemAllocator_;
 };
 
+/** @class MonotonicAllocator
+ *  @brief An arena allocator that bump allocates from a fixed buffer and releases memory in bulk.
+ *  It is not inherently threadsafe.
+ *
+ *  Allocation simply advances an offset into the buffer, so it is constant time and never
+ *  fragments. Individual deallocations do not release memory (other than the most recent
+ *  allocation, which is rolled back). Instead, a Marker records the current offset and rewinds the
+ *  arena to it when destroyed, releasing everything allocated in its scope at once. Markers must be
+ *  destroyed in the reverse order they were created. For example:
+ *
+ *  @code
+ *  Arena<512> arena{"Request"};
+ *  {
+ *    auto scope = arena.mark();
+ *    auto* buf = static_cast<char*>(arena.allocate(128));
+ *    ...
+ *  } //buf and anything else allocated in this scope are released here.
+ *  @endcode
+ *
+ *  @note Objects placed in the arena must still be destroyed by their owner; rewinding releases the
+ *  memory but does not run destructors.
+ * */
+class MonotonicAllocator : public AllocatorStatisticsInterface, public AllocatorInterface
+{
+public:
+  /** All allocations are aligned to this boundary. */
+  static constexpr size_t alignment_Bytes = 8;
+  /** @class Marker
+   *  @brief RAII scope that rewinds the arena to the position it was created at. */
+  class Marker
+  {
+  public:
+    Marker(Marker&& other) noexcept : arena_{other.arena_}, offset_{other.offset_}
+      { other.arena_ = nullptr; }
+    Marker(const Marker&) = delete;
+    Marker& operator=(const Marker&) = delete;
+    Marker& operator=(Marker&&) = delete;
+    ~Marker() noexcept { if(arena_ != nullptr) { arena_->rewind(offset_); } }
+  private:
+    friend MonotonicAllocator;
+    Marker(MonotonicAllocator* arena, size_t offset) noexcept : arena_{arena}, offset_{offset} {}
+    MonotonicAllocator* arena_;
+    size_t offset_;
+  };
+  /** Construct an arena over an externally owned buffer of size_Bytes. The buffer must outlive the
+   * arena. */
+  MonotonicAllocator(void* buffer, size_t size_Bytes, const char* name = "Arena") noexcept;
+  MonotonicAllocator(const MonotonicAllocator&) = delete;
+  MonotonicAllocator(MonotonicAllocator&&) = delete;
+  MonotonicAllocator& operator=(const MonotonicAllocator&) = delete;
+  MonotonicAllocator& operator=(MonotonicAllocator&&) = delete;
+  /** Returns size bytes from the arena. Throws std::bad_alloc if the arena is exhausted. */
+  void* allocate(size_t size) override final;
+  /** Only the most recent allocation is actually released; other calls have no effect until the
+   * arena is rewound. */
+  void deallocate(void* ptr) override final;
+  /** Create a Marker at the current position. */
+  Marker mark() noexcept { return Marker{this, offset_}; }
+  /** Release every allocation. Any outstanding Markers must not be used afterwards. */
+  void reset() noexcept { rewind(0); }
+  size_t freeSpace_Bytes() const noexcept override final { return size_ - offset_; }
+  size_t minimumFreeSpace_Bytes() const noexcept override final { return size_ - highWater_; }
+  size_t totalSpace_Bytes() const noexcept override final { return size_; }
+private:
+  uint8_t* const buffer_;
+  const size_t size_;
+  size_t offset_;
+  size_t lastOffset_;
+  size_t highWater_;
+  void rewind(size_t offset) noexcept;
+};
+
+/** @class Arena
+ *  @brief A MonotonicAllocator that owns a buffer of size_Bytes. */
+template<size_t size_Bytes>
+class Arena : public MonotonicAllocator
+{
+public:
+  Arena(const char* name = "Arena") noexcept : MonotonicAllocator(mem_, size_Bytes, name) {}
+private:
+  uint8_t mem_[size_Bytes] __attribute__((aligned(MonotonicAllocator::alignment_Bytes)));
+};
+
+/** @class StdAllocator
+ *  @brief An STL compatible allocator that forwards to a jel AllocatorInterface.
+ *
+ *  A default constructed StdAllocator uses the SystemAllocator. Two StdAllocators compare equal
+ *  when they use the same AllocatorInterface, so memory allocated through one can be released
+ *  through the other. The AllocatorInterface must outlive every container using it. For example:
+ *
+ *  @code
+ *  BlockAllocator<32, 64> pool{"VecPool"};
+ *  std::vector<int, StdAllocator<int>> v{StdAllocator<int>{pool}};
+ *  @endcode
+ *
+ *  @note AllocatorInterface does not accept an alignment. The allocated memory is checked against
+ *  alignof(T) and std::bad_alloc is thrown if the underlying allocator cannot satisfy it (the
+ *  BlockAllocator, for instance, only guarantees 4 byte alignment).
+ * */
+template<typename T>
+class StdAllocator
+{
+public:
+  using value_type = T;
+  StdAllocator() noexcept : alloc_{SystemAllocator::systemAllocator()} {}
+  StdAllocator(AllocatorInterface& allocator) noexcept : alloc_{&allocator} {}
+  template<typename U>
+  StdAllocator(const StdAllocator<U>& other) noexcept : alloc_{other.allocator()} {}
+  T* allocate(size_t n)
+  {
+    if(n > (SIZE_MAX / sizeof(T))) { throw std::bad_alloc(); }
+    void* ptr = alloc_->allocate(n * sizeof(T));
+    if(ptr == nullptr) { throw std::bad_alloc(); }
+    if((reinterpret_cast<uintptr_t>(ptr) % alignof(T)) != 0)
+    {
+      alloc_->deallocate(ptr);
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(ptr);
+  }
+  void deallocate(T* ptr, size_t) noexcept { alloc_->deallocate(ptr); }
+  AllocatorInterface* allocator() const noexcept { return alloc_; }
+private:
+  AllocatorInterface* alloc_;
+};
+
+template<typename T, typename U>
+bool operator==(const StdAllocator<T>& lhs, const StdAllocator<U>& rhs) noexcept
+{
+  return lhs.allocator() == rhs.allocator();
+}
+
+template<typename T, typename U>
+bool operator!=(const StdAllocator<T>& lhs, const StdAllocator<U>& rhs) noexcept
+{
+  return !(lhs == rhs);
+}
+
+#if __has_include(<memory_resource>)
+/** @class MemoryResource
+ *  @brief A std::pmr::memory_resource that forwards to a jel AllocatorInterface.
+ *
+ *  This allows std::pmr containers to draw from any jel allocator. As with StdAllocator, requested
+ *  alignments that the underlying allocator does not meet result in std::bad_alloc. Only available
+ *  when the standard library provides <memory_resource>.
+ * */
+class MemoryResource : public std::pmr::memory_resource
+{
+public:
+  MemoryResource(AllocatorInterface& allocator) noexcept : alloc_{allocator} {}
+  AllocatorInterface& allocator() const noexcept { return alloc_; }
+private:
+  AllocatorInterface& alloc_;
+  void* do_allocate(size_t bytes, size_t alignment) override
+  {
+    void* ptr = alloc_.allocate(bytes == 0 ? 1 : bytes);
+    if(ptr == nullptr) { throw std::bad_alloc(); }
+    if((reinterpret_cast<uintptr_t>(ptr) % alignment) != 0)
+    {
+      alloc_.deallocate(ptr);
+      throw std::bad_alloc();
+    }
+    return ptr;
+  }
+  void do_deallocate(void* ptr, size_t, size_t) override { alloc_.deallocate(ptr); }
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+  {
+    //Resources are only interchangeable if they forward to the same allocator. RTTI is avoided, so
+    //only identical resources compare equal.
+    return this == &other;
+  }
+};
+#endif
+
 /** @class ObjectPool
  *  @brief A 'pool' of a given object that allows RAII acquisition and release of an object stored
  *  in a container.
@@ -316,6 +607,13 @@ private:
  *  size is ideal (with some small, 4 byte overhead) for an allocation. 
  *  Note that the BlockAllocator is not immune to fragmentation issues; allocations are placed in
  *  the first found set of contiguous blocks that is large enough.
+ *
+ *  Block usage is tracked in a bitmap that is always processed a full word at a time using count
+ *  leading/trailing zero instructions. A second level summary bitmap records which bitmap words
+ *  still contain a free block. Single block allocations are therefore found in constant time (for
+ *  pools of up to 1024 blocks, beyond which one summary word is scanned per 1024 blocks) and runs
+ *  of blocks are found in at most one pass over the bitmap words, never a pass over the individual
+ *  blocks.
  * */
 template<size_t blockSize_Bytes, size_t totalBlocks>
 class BlockAllocator : public AllocatorStatisticsInterface, public AllocatorInterface
@@ -326,9 +624,22 @@ public:
     nblk_{totalBlocks}, blksz_{blockSize_Bytes}, sz_{totalBlocks * blockSize_Bytes},
     fblkcnt_{totalBlocks}, minfblkcnt_{totalBlocks}
   {
-    for(size_t i = 0; i < nblk_; i++)
+    for(size_t i = 0; i < bitmapWords; i++)
+    {
+      iuf_[i] = 0;
+    }
+    //Blocks past the end of the pool in the last bitmap word are permanently marked as in-use.
+    if((totalBlocks % bitsPerWord) != 0)
+    {
+      iuf_[bitmapWords - 1] = ~((Word{1} << (totalBlocks % bitsPerWord)) - 1);
+    }
+    for(size_t i = 0; i < summaryWords; i++)
+    {
+      nfw_[i] = 0;
+    }
+    for(size_t i = 0; i < bitmapWords; i++)
     {
-      iuf_[i] = false;
+      updateSummary(i);
     }
   }
   BlockAllocator(const BlockAllocator&) = delete;
@@ -338,6 +649,16 @@ public:
   size_t freeSpace_Bytes() const noexcept final override { return fblkcnt_ * blksz_; };
   size_t minimumFreeSpace_Bytes() const noexcept final override { return minfblkcnt_ * blksz_; };
   size_t totalSpace_Bytes() const noexcept final override { return sz_; };
+  size_t largestFreeBlock_Bytes() const noexcept final override
+  {
+    size_t longest = 0; size_t run = 0;
+    for(size_t i = 0; i < nblk_; i++)
+    {
+      if(iuf_[i / bitsPerWord] & (Word{1} << (i % bitsPerWord))) { run = 0; }
+      else if(++run > longest) { longest = run; }
+    }
+    return longest * blksz_;
+  }
   void* allocate(size_t size_Bytes) final override
   {
     if(size_Bytes == 0) { return nullptr; }
@@ -345,38 +666,15 @@ public:
     if(size_Bytes >= sz_) { throw std::bad_alloc(); }
     size_t blksreq = size_Bytes / blksz_;
     if((size_Bytes % blksz_) != 0) { blksreq++; }
-    size_t contBlocks = 0;
-    size_t* poolMemPtr = nullptr;
-    size_t firstFreeIdx;
-    for(size_t i = 0; i < nblk_; i++)
-    {
-      if(!iuf_[i]) //Scan through in-use-flags for free blocks.
-      {
-        if(++contBlocks == blksreq)
-        {
-          //A chunk of free blocks long enough is found. Lets get a pointer to the beginning of the
-          //memory chunk.
-          poolMemPtr = reinterpret_cast<size_t*>
-            (reinterpret_cast<size_t>(mem_) + (((i + 1) - contBlocks) * blksz_));
-          firstFreeIdx = i; //Don't set block flags here, if an exception is raised due to OOM it 
-          //will leave pool in an illegal state.
-          break;
-        }
-      }
-      else
-      {
-        contBlocks = 0; //This block isn't free, so our current free block length is reset.
-      }
-    }
-    if(!poolMemPtr) { throw std::bad_alloc(); } //No string of free blocks long enough found.
-    for(size_t j = contBlocks; j > 0;)
-    {
-      iuf_[(firstFreeIdx + 1) - j--] = true; //Set in-use-flags for each block.
-    }
+    if(blksreq > fblkcnt_) { throw std::bad_alloc(); }
+    size_t firstBlk = (blksreq == 1) ? findFreeBlock() : findFreeRun(blksreq);
+    if(firstBlk == noBlock) { throw std::bad_alloc(); } //No string of free blocks long enough.
+    setRange(firstBlk, blksreq, true);
+    size_t* poolMemPtr = reinterpret_cast<size_t*>(&mem_[firstBlk * blksz_]);
     *poolMemPtr = blksreq; //Store total blocks in this allocation. This is used when deallocating.
     //Update current free/min free block count for statistics interface.
     fblkcnt_ -= blksreq; if(fblkcnt_ < minfblkcnt_) { minfblkcnt_ = fblkcnt_; }
-    recordAllocation();
+    recordAllocation(poolMemPtr + 1, size_Bytes - sizeof(size_t), __builtin_return_address(0));
     return poolMemPtr += 1; //Return pointer w/ 4B offset to hide our blksreq value.
   }
   void deallocate(void* itemPtr) final override
@@ -388,22 +686,120 @@ public:
     size_t btof = *mptr;
     size_t iufFirstFlag = 
       (reinterpret_cast<size_t>(mptr) - reinterpret_cast<size_t>(mem_)) / blksz_;
-    assert(iufFirstFlag < iuf_.size());
-    for(size_t i = iufFirstFlag; i < iufFirstFlag + btof;)
-    {
-      iuf_[i++] = false;
-    }
+    assert(iufFirstFlag + btof <= nblk_);
+    setRange(iufFirstFlag, btof, false);
     fblkcnt_ += btof; 
-    recordDeallocation();
+    recordDeallocation(itemPtr, btof * blksz_, __builtin_return_address(0));
   }
 private:
+  using Word = uint32_t;
+  static constexpr size_t bitsPerWord = sizeof(Word) * 8;
+  static constexpr size_t bitmapWords = (totalBlocks + bitsPerWord - 1) / bitsPerWord;
+  static constexpr size_t summaryWords = (bitmapWords + bitsPerWord - 1) / bitsPerWord;
+  static constexpr Word fullWord = ~Word{0};
+  static constexpr size_t noBlock = SIZE_MAX;
+  static_assert(totalBlocks > 0, "A BlockAllocator requires at least one block.");
+  static_assert(blockSize_Bytes >= sizeof(size_t), "The block size must fit the block header.");
   const size_t nblk_; 
   const size_t blksz_; 
   const size_t sz_; 
   size_t fblkcnt_;
   size_t minfblkcnt_;
-  std::bitset<totalBlocks> iuf_; 
+  /** In-use flags, one bit per block. A set bit indicates the block is allocated. */
+  Word iuf_[bitmapWords];
+  /** Non-full word flags, one bit per iuf_ word. A set bit indicates the word has a free block. */
+  Word nfw_[summaryWords];
   uint8_t mem_[blockSize_Bytes * totalBlocks] __attribute__((aligned(4)));
+  static size_t countTrailingZeros(const Word w) noexcept { return __builtin_ctz(w); }
+  void updateSummary(const size_t word) noexcept
+  {
+    const Word bit = Word{1} << (word % bitsPerWord);
+    if(iuf_[word] == fullWord) { nfw_[word / bitsPerWord] &= ~bit; }
+    else { nfw_[word / bitsPerWord] |= bit; }
+  }
+  /** Returns the index of the first bitmap word containing a free block, or bitmapWords if the
+   * pool is full. */
+  size_t firstNonFullWord() const noexcept
+  {
+    for(size_t i = 0; i < summaryWords; i++)
+    {
+      if(nfw_[i] != 0)
+      {
+        return (i * bitsPerWord) + countTrailingZeros(nfw_[i]);
+      }
+    }
+    return bitmapWords;
+  }
+  size_t findFreeBlock() const noexcept
+  {
+    size_t word = firstNonFullWord();
+    if(word >= bitmapWords) { return noBlock; }
+    return (word * bitsPerWord) + countTrailingZeros(~iuf_[word]);
+  }
+  /** First-fit search for blksreq contiguous free blocks. Whole words of free or used blocks are
+   * consumed in a single step, and partial words are consumed one free or used run at a time. */
+  size_t findFreeRun(const size_t blksreq) const noexcept
+  {
+    size_t runStart = 0;
+    size_t runLen = 0;
+    for(size_t word = firstNonFullWord(); word < bitmapWords; word++)
+    {
+      const Word freeBits = ~iuf_[word];
+      if(freeBits == fullWord)
+      {
+        if(runLen == 0) { runStart = word * bitsPerWord; }
+        runLen += bitsPerWord;
+        if(runLen >= blksreq) { return runStart; }
+        continue;
+      }
+      if(freeBits == 0)
+      {
+        runLen = 0;
+        continue;
+      }
+      size_t bit = 0;
+      while(bit < bitsPerWord)
+      {
+        const Word remaining = freeBits >> bit;
+        if(remaining == 0)
+        {
+          //Only used blocks remain in this word.
+          runLen = 0;
+          break;
+        }
+        if((remaining & 1) == 0)
+        {
+          //Skip the used blocks to the next free block.
+          runLen = 0;
+          bit += countTrailingZeros(remaining);
+          continue;
+        }
+        //Bits shifted in from the top are zero, so ~remaining always has a set bit here.
+        const size_t freeCount = countTrailingZeros(~remaining);
+        if(runLen == 0) { runStart = (word * bitsPerWord) + bit; }
+        runLen += freeCount;
+        if(runLen >= blksreq) { return runStart; }
+        bit += freeCount;
+      }
+    }
+    return noBlock;
+  }
+  /** Sets or clears the in-use flags for count blocks starting at firstBlk, one word at a time. */
+  void setRange(size_t firstBlk, size_t count, const bool inUse) noexcept
+  {
+    while(count > 0)
+    {
+      const size_t word = firstBlk / bitsPerWord;
+      const size_t bit = firstBlk % bitsPerWord;
+      const size_t n = (count < (bitsPerWord - bit)) ? count : (bitsPerWord - bit);
+      const Word mask = (n == bitsPerWord) ? fullWord : (((Word{1} << n) - 1) << bit);
+      if(inUse) { iuf_[word] |= mask; }
+      else { iuf_[word] &= ~mask; }
+      updateSummary(word);
+      firstBlk += n;
+      count -= n;
+    }
+  }
 };
 
 } /** namespace jel */
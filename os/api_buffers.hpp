@@ -0,0 +1,218 @@
+/** @file os/api_buffers.hpp
+ *  @brief Interface for byte stream and variable length message buffers.
+ *
+ *  @detail
+ *    Queues transfer fixed size elements. Variable length data such as UART frames, log text or
+ *    protocol packets is better served by the StreamBuffer and MessageBuffer classes, which wrap
+ *    the RTOS stream and message buffer primitives. Data is copied once into the buffer on send,
+ *    and once directly into the caller's buffer on receive.
+ *
+ *    A StreamBuffer transfers an unstructured stream of bytes; a reader may receive any number of
+ *    bytes at a time, and can defer its wakeup until a trigger level of bytes has accumulated. A
+ *    MessageBuffer transfers discrete messages; each receive returns exactly one complete message.
+ *
+ *    Like Queue and StaticQueue, the StreamBuffer/MessageBuffer classes allocate their storage
+ *    from the heap, while StaticStreamBuffer/StaticMessageBuffer hold it inline and never touch
+ *    the heap.
+ *
+ *    @note Stream and message buffers assume a single writer and a single reader (which may be
+ *    ISRs). Multiple writers or readers must serialize access externally, e.g. with a Mutex, or a
+ *    CriticalSection when ISRs are involved.
+ *
+ *  @author Jonathan Thomson 
+ */
+/**
+ * MIT License
+ * 
+ * Copyright 2018, Jonathan Thomson 
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+/** C/C++ Standard Library Headers */
+#include <cstddef>
+#include <cstdint>
+/** jel Library Headers */
+#include "os/api_common.hpp"
+#include "os/api_time.hpp"
+#include "os/api_queues.hpp"
+
+namespace jel
+{
+/** @class ByteBuffer_Base
+ *  @brief This base class is used strictly as a helper and should not be used in the application
+ *  directly.
+ * */
+class ByteBuffer_Base
+{
+protected:
+  ByteBuffer_Base(const size_t capacity_Bytes, const size_t triggerLevel_Bytes, uint8_t* storage,
+    const bool isMessageBuffer);
+  ~ByteBuffer_Base() noexcept;
+  size_t genericSend(const void* data, const size_t length_Bytes, const Duration& timeout) noexcept;
+  size_t genericReceive(void* buffer, const size_t bufferLength_Bytes,
+    const Duration& timeout) noexcept;
+  size_t genericBytesAvailable() const noexcept;
+  size_t genericFreeSpace() const noexcept;
+  Status genericReset() noexcept;
+  Status genericSetTriggerLevel(const size_t triggerLevel_Bytes) noexcept;
+private:
+  using CbStorage = uint8_t[36];
+  using Handle = void*;
+  Handle handle_;
+  CbStorage cbMemory_ __attribute__((aligned(4)));
+};
+
+/** @class StreamBuffer
+ *  @brief A threadsafe, RTOS backed byte stream between one writer and one reader.
+ *
+ *  The reader blocks in receive() until at least the trigger level of bytes is available (or the
+ *  timeout expires, in which case whatever is available is returned). Raising the trigger level
+ *  batches wakeups, so a reader of a byte-at-a-time producer such as a UART ISR is woken once per
+ *  chunk rather than once per byte.
+ *  */
+class StreamBuffer : private QueueMemoryHelper, private ByteBuffer_Base
+{
+protected:
+  /** Construct a StreamBuffer on top of externally owned storage of storage_Bytes(capacity). */
+  StreamBuffer(const size_t capacity_Bytes, const size_t triggerLevel_Bytes, uint8_t* storage) :
+    QueueMemoryHelper(storage), ByteBuffer_Base(capacity_Bytes, triggerLevel_Bytes, storage, false)
+  {}
+public:
+  /** Construct a StreamBuffer, allocating its storage from the heap. */
+  StreamBuffer(const size_t capacity_Bytes, const size_t triggerLevel_Bytes = 1) :
+    QueueMemoryHelper(storage_Bytes(capacity_Bytes)),
+    ByteBuffer_Base(capacity_Bytes, triggerLevel_Bytes, itemMemory_, false) {}
+  /** Copies up to length_Bytes of data into the buffer, waiting up to timeout for enough space to
+   * write all of it. Returns the number of bytes actually written, which is less than length_Bytes
+   * if the timeout expired. ISR safe (the timeout is ignored). */
+  size_t send(const void* data, const size_t length_Bytes,
+    const Duration& timeout = Duration::max()) noexcept
+  {
+    return genericSend(data, length_Bytes, timeout);
+  }
+  /** Copies up to bufferLength_Bytes of data directly into buffer, waiting up to timeout for the
+   * trigger level to be reached. Returns the number of bytes received. ISR safe (the timeout is
+   * ignored). */
+  size_t receive(void* buffer, const size_t bufferLength_Bytes,
+    const Duration& timeout = Duration::max()) noexcept
+  {
+    return genericReceive(buffer, bufferLength_Bytes, timeout);
+  }
+  /** The number of bytes waiting to be received. */
+  size_t size() const noexcept { return genericBytesAvailable(); }
+  bool empty() const noexcept { return size() == 0; }
+  /** The number of bytes that can be sent without blocking. */
+  size_t freeSpace() const noexcept { return genericFreeSpace(); }
+  /** Discards all buffered data. Fails if a thread is blocked on the buffer. */
+  Status reset() noexcept { return genericReset(); }
+  /** Changes the number of bytes that must be available before a blocked reader is woken. Fails
+   * if the trigger level is larger than the capacity. */
+  Status setTriggerLevel(const size_t triggerLevel_Bytes) noexcept
+  {
+    return genericSetTriggerLevel(triggerLevel_Bytes);
+  }
+  /** Bytes of storage required for a StreamBuffer with the given capacity. */
+  static constexpr size_t storage_Bytes(const size_t capacity_Bytes) noexcept
+  {
+    //The RTOS requires one byte more than the capacity to distinguish full from empty.
+    return capacity_Bytes + 1;
+  }
+};
+
+/** @class StaticStreamBuffer
+ *  @brief A StreamBuffer whose storage is held inline. No heap allocation is performed.
+ *  */
+template<size_t capacity_Bytes, size_t triggerLevel_Bytes = 1>
+class StaticStreamBuffer : public StreamBuffer
+{
+  static_assert(capacity_Bytes > 0, "A StaticStreamBuffer must hold at least one byte.");
+  static_assert(triggerLevel_Bytes <= capacity_Bytes, "Trigger level exceeds capacity.");
+  uint8_t staticMemory_[StreamBuffer::storage_Bytes(capacity_Bytes)];
+public:
+  StaticStreamBuffer() : StreamBuffer(capacity_Bytes, triggerLevel_Bytes, staticMemory_) {}
+  /** Total RAM used by this StaticStreamBuffer. */
+  static constexpr size_t footprint_Bytes() noexcept { return sizeof(StaticStreamBuffer); }
+};
+
+/** @class MessageBuffer
+ *  @brief A threadsafe, RTOS backed buffer of variable length messages between one writer and one
+ *  reader.
+ *
+ *  Each message is stored with a messageHeader_Bytes length prefix, which must be accounted for
+ *  when sizing the buffer.
+ *  */
+class MessageBuffer : private QueueMemoryHelper, private ByteBuffer_Base
+{
+protected:
+  /** Construct a MessageBuffer on top of externally owned storage of storage_Bytes(capacity). */
+  MessageBuffer(const size_t capacity_Bytes, uint8_t* storage) : QueueMemoryHelper(storage),
+    ByteBuffer_Base(capacity_Bytes, 1, storage, true) {}
+public:
+  /** Bytes of buffer space consumed by each message in addition to its payload. */
+  static constexpr size_t messageHeader_Bytes = sizeof(size_t);
+  /** Construct a MessageBuffer, allocating its storage from the heap. */
+  MessageBuffer(const size_t capacity_Bytes) : QueueMemoryHelper(storage_Bytes(capacity_Bytes)),
+    ByteBuffer_Base(capacity_Bytes, 1, itemMemory_, true) {}
+  /** Writes one complete message, waiting up to timeout for enough space. A message is never
+   * partially written. ISR safe (the timeout is ignored). */
+  Status send(const void* message, const size_t length_Bytes,
+    const Duration& timeout = Duration::max()) noexcept
+  {
+    return genericSend(message, length_Bytes, timeout) == length_Bytes ? Status::success :
+      Status::failure;
+  }
+  /** Copies the next message directly into buffer, waiting up to timeout for one to arrive.
+   * Returns the message length, or zero if no message arrived. If the message does not fit in
+   * bufferLength_Bytes, zero is returned and the message is left in the buffer. ISR safe (the
+   * timeout is ignored). */
+  size_t receive(void* buffer, const size_t bufferLength_Bytes,
+    const Duration& timeout = Duration::max()) noexcept
+  {
+    return genericReceive(buffer, bufferLength_Bytes, timeout);
+  }
+  /** The number of bytes of buffer space in use, including message headers. */
+  size_t size() const noexcept { return genericBytesAvailable(); }
+  bool empty() const noexcept { return size() == 0; }
+  /** The number of bytes of buffer space free, including space needed for message headers. */
+  size_t freeSpace() const noexcept { return genericFreeSpace(); }
+  /** Discards all buffered messages. Fails if a thread is blocked on the buffer. */
+  Status reset() noexcept { return genericReset(); }
+  /** Bytes of storage required for a MessageBuffer with the given capacity. */
+  static constexpr size_t storage_Bytes(const size_t capacity_Bytes) noexcept
+  {
+    return capacity_Bytes + 1;
+  }
+};
+
+/** @class StaticMessageBuffer
+ *  @brief A MessageBuffer whose storage is held inline. No heap allocation is performed.
+ *  */
+template<size_t capacity_Bytes>
+class StaticMessageBuffer : public MessageBuffer
+{
+  static_assert(capacity_Bytes > MessageBuffer::messageHeader_Bytes,
+    "A StaticMessageBuffer must be able to hold at least one message.");
+  uint8_t staticMemory_[MessageBuffer::storage_Bytes(capacity_Bytes)];
+public:
+  StaticMessageBuffer() : MessageBuffer(capacity_Bytes, staticMemory_) {}
+  /** Total RAM used by this StaticMessageBuffer. */
+  static constexpr size_t footprint_Bytes() noexcept { return sizeof(StaticMessageBuffer); }
+};
+
+} /** namespace jel */
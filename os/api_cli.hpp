@@ -288,6 +288,10 @@ public:
    * @throws ExceptionCode::cliArgumentReadTimeout in the event no valid data is read before the
    * timeout occurs. */
   double readDouble(const char* prompt = nullptr, const Duration& timeout = Duration::max());
+  /** Returns a small arena allocator for temporary memory used while the command executes. Memory
+   * allocated from it does not need to be released; it is all reclaimed when the command returns.
+   * std::bad_alloc is thrown if the arena is exhausted. */
+  AllocatorInterface& scratch() noexcept;
   /** The current formatting configuration to use when printing. */
   FormatSpecifer fmt;
   /** A pointer to the CommandEntry value for this specific command. */
@@ -143,10 +143,10 @@ template<typename F>
 class ScopeGuard
 {
 public:
-  ScopeGuard(const F& onExit) : exit_(onExit) { }
+  ScopeGuard(const F& onExit) : runOnExit(true), exit_(onExit) { }
   template<typename Fcreate>
-  ScopeGuard(const Fcreate& onEntry, const F& onExit) : exit_(onExit) 
-    { runOnExit = true; onEntry(); }
+  ScopeGuard(const Fcreate& onEntry, const F& onExit) : runOnExit(true), exit_(onExit)
+    { onEntry(); }
   ~ScopeGuard() { if(runOnExit) { exit_(); } }
   bool runOnExit;
 private:
@@ -52,6 +52,16 @@ namespace jel
 {
 namespace config
 {
+/** @struct SlabClassConfiguration
+ *  @brief Describes one size class of a fixed block pool, such as the system allocator slab
+ *  front-end or the exception pool. Requests of up to blockSize_Bytes are served from a pool of
+ *  totalBlocks blocks instead of the system heap. Block sizes must be multiples of 8 and listed in
+ *  ascending order. */
+struct SlabClassConfiguration
+{
+  size_t blockSize_Bytes;
+  size_t totalBlocks;
+};
 #ifdef HW_TARGET_TM4C123GH6PM
 /** Determines the total number of strings in the jel shared string pool. The string pool is used
  *  by the CLI and logger. 
@@ -92,6 +102,17 @@ constexpr size_t cliHistoryDepth = 3;
  * */
 constexpr size_t cliMaximumArguments = 8;
 constexpr size_t cliMaximumStringLength = 128;
+/** If true, small allocations made through the system allocator (including new and malloc) are
+ * first served from fixed block pools for each size class in systemSlabClasses, falling through to
+ * the system heap only when no class fits or the class is exhausted. The pool memory is taken from
+ * the system heap once, during system allocator construction. */
+constexpr bool useSystemSlab = false;
+constexpr SlabClassConfiguration systemSlabClasses[] = { {16, 32}, {32, 16} };
+/** Size classes for the exception emergency pool. Each block holds the C++ runtime exception
+ * header (128 bytes on ARM EABI) plus the thrown object. Thrown exceptions are allocated from the
+ * smallest free block that fits, falling back to the system heap only when every suitable block is
+ * in use. Each class may hold at most 32 blocks, and block sizes must be multiples of 16. */
+constexpr SlabClassConfiguration exceptionPoolClasses[] = { {192, 2}, {320, 1} };
 #elif defined(HW_TARGET_TM4C1294NCPDT)
 /** Determines the total number of strings in the jel shared string pool. The string pool is used
  *  by the CLI and logger. 
@@ -132,6 +153,17 @@ constexpr size_t cliHistoryDepth = 12;
  * */
 constexpr size_t cliMaximumArguments = 8;
 constexpr size_t cliMaximumStringLength = 256;
+/** If true, small allocations made through the system allocator (including new and malloc) are
+ * first served from fixed block pools for each size class in systemSlabClasses, falling through to
+ * the system heap only when no class fits or the class is exhausted. The pool memory is taken from
+ * the system heap once, during system allocator construction. */
+constexpr bool useSystemSlab = true;
+constexpr SlabClassConfiguration systemSlabClasses[] = { {16, 128}, {32, 128}, {64, 64} };
+/** Size classes for the exception emergency pool. Each block holds the C++ runtime exception
+ * header (128 bytes on ARM EABI) plus the thrown object. Thrown exceptions are allocated from the
+ * smallest free block that fits, falling back to the system heap only when every suitable block is
+ * in use. Each class may hold at most 32 blocks, and block sizes must be multiples of 16. */
+constexpr SlabClassConfiguration exceptionPoolClasses[] = { {192, 4}, {384, 2} };
 #elif defined(HW_TARGET_STM32F302RCT6)
 constexpr size_t stringPoolStringCount = 24;
 constexpr size_t stringPoolStringSize = 256;
@@ -139,6 +171,9 @@ constexpr bool optimizeStringMemory = true;
 constexpr size_t cliHistoryDepth = 8;
 constexpr size_t cliMaximumArguments = 12;
 constexpr size_t cliMaximumStringLength = 128;
+constexpr bool useSystemSlab = true;
+constexpr SlabClassConfiguration systemSlabClasses[] = { {16, 64}, {32, 32}, {64, 16} };
+constexpr SlabClassConfiguration exceptionPoolClasses[] = { {192, 2}, {384, 1} };
 #else
 constexpr size_t stringPoolStringCount = 24;
 constexpr size_t stringPoolStringSize = 256;
@@ -146,6 +181,9 @@ constexpr bool optimizeStringMemory = true;
 constexpr size_t cliHistoryDepth = 8;
 constexpr size_t cliMaximumArguments = 12;
 constexpr size_t cliMaximumStringLength = 128;
+constexpr bool useSystemSlab = true;
+constexpr SlabClassConfiguration systemSlabClasses[] = { {16, 128}, {32, 128}, {64, 64} };
+constexpr SlabClassConfiguration exceptionPoolClasses[] = { {192, 4}, {384, 2} };
 #endif
 
 static_assert(stringPoolStringCount > (cliHistoryDepth + 4),
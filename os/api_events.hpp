@@ -0,0 +1,111 @@
+/** @file os/api_events.hpp
+ *  @brief Interface for the event group synchronization primitive.
+ *
+ *  @detail
+ *    An EventGroup holds a set of event flag bits that threads can wait on, either for any or for
+ *    all of a mask of bits. A single EventGroup can replace several Semaphores when a thread waits
+ *    on more than one condition, which saves the RAM of the additional semaphores and the context
+ *    switches needed to take them one at a time.
+ *
+ *  @author Jonathan Thomson
+ */
+/**
+ * MIT License
+ *
+ * Copyright 2018, Jonathan Thomson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+/** C/C++ Standard Library Headers */
+#include <cstdint>
+/** jel Library Headers */
+#include "os/api_common.hpp"
+#include "os/api_time.hpp"
+
+namespace jel
+{
+
+/** @class EventGroup
+ *  @brief A threadsafe, RTOS backed set of event flag bits.
+ *
+ *  Threads block in waitAny() or waitAll() until the requested bits are set by set(), optionally
+ *  clearing them as the wait completes. sync() implements a rendezvous, where each participating
+ *  thread sets its own bit and waits for the bits of all other participants.
+ *  @code
+ *    constexpr EventGroup::Bits rxDone = 0x1, txDone = 0x2;
+ *    EventGroup events;
+ *    //...in the driver ISRs: events.set(rxDone); events.set(txDone);
+ *    EventGroup::Bits fired = events.waitAny(rxDone | txDone, Duration::milliseconds(10));
+ *    if(fired & rxDone) { handleRx(); }
+ *  @endcode
+ *
+ *  Like the Lock classes, the EventGroup detects ISR context automatically. An RTOS event group
+ *  cannot be modified directly from an ISR, because an unknown number of waiting threads may need
+ *  to be woken. Instead, set() and clear() called from an ISR are deferred to the RTOS timer daemon
+ *  thread, which runs at Thread::Priority::maximum and applies the change as soon as the ISR
+ *  returns. They fail if the timer daemon command queue is full.
+ *  @note The RTOS control block is held inline (no heap is used) and an EventGroup must outlive
+ *  any deferred ISR set() or clear() calls made on it.
+ *  @note With 32 bit ticks, the upper 8 bits of the group are reserved by the RTOS; only the bits
+ *  within usableBits may be used.
+ *  */
+class EventGroup
+{
+public:
+  using Bits = uint32_t;
+  static constexpr Bits usableBits = 0x00FF'FFFF;
+  EventGroup();
+  ~EventGroup() noexcept;
+  EventGroup(const EventGroup&) = delete;
+  EventGroup(EventGroup&&) = delete;
+  EventGroup& operator=(const EventGroup&) = delete;
+  EventGroup& operator=(EventGroup&&) = delete;
+  /** Sets bits, waking any threads whose wait conditions are now met. From an ISR the set is
+   * deferred to the timer daemon, and Status::failure is returned if it could not be queued. */
+  Status set(const Bits bits) noexcept;
+  /** Clears bits. From an ISR the clear is deferred to the timer daemon, and Status::failure is
+   * returned if it could not be queued. */
+  Status clear(const Bits bits) noexcept;
+  /** Returns the bits that are currently set. */
+  Bits get() const noexcept;
+  /** Waits up to timeout for any of bits to be set. Returns the bits within bits that were set
+   * when the wait completed, or 0 on a timeout. If clearOnExit is true, the returned bits are
+   * cleared. May not be called from an ISR. */
+  Bits waitAny(const Bits bits, const Duration& timeout = Duration::max(),
+    const bool clearOnExit = true) noexcept;
+  /** Waits up to timeout for all of bits to be set. Returns the bits within bits that were set
+   * when the wait completed, which is equal to bits on success. If clearOnExit is true, bits are
+   * cleared on success. May not be called from an ISR. */
+  Bits waitAll(const Bits bits, const Duration& timeout = Duration::max(),
+    const bool clearOnExit = true) noexcept;
+  /** Atomically sets setBits and then waits up to timeout for all of waitBits to be set. On
+   * success waitBits are cleared, releasing all participants of the rendezvous together, and
+   * Status::success is returned. May not be called from an ISR. */
+  Status sync(const Bits setBits, const Bits waitBits,
+    const Duration& timeout = Duration::max()) noexcept;
+private:
+  using CbStorage = uint8_t[32];
+  using Handle = void*;
+  Handle handle_;
+  CbStorage cbMemory_ __attribute__((aligned(4)));
+  Bits wait(const Bits bits, const bool waitForAll, const Duration& timeout,
+    const bool clearOnExit) noexcept;
+};
+
+} /** namespace jel */
@@ -11,8 +11,13 @@
  *        -A counting semaphore. This is also ISR safe.
  *        -A mutex. This is not ISR safe.
  *        -A fully recursive mutex. This is not ISR safe.
+ *        -A fast mutex, which only calls into the RTOS when contended. This is not ISR safe.
  *      -A generic RAII guard class. Supports all locking primitives and provides RAII capture and
  *      release capabilities.
+ *      -A SharedMutex (reader-writer lock) with writer preference, and RAII guards for its shared
+ *      and exclusive modes.
+ *      -A Notification, a lightweight ISR to thread signal built on RTOS task notifications. It
+ *      supports binary, counting and bit flag modes and needs no RTOS object of its own.
  *
  *  @author Jonathan Thomson 
  */
@@ -40,20 +45,114 @@
 #pragma once
 
 /** C/C++ Standard Library Headers */
-
+#include <atomic>
+#include <cstdint>
 /** jel Library Headers */
 #include "os/api_common.hpp"
+#include "os/api_events.hpp"
 #include "os/api_time.hpp"
 
+/** When defined, every Lock keeps a LockStatistics record of its acquisitions, how many of them
+ * had to wait, the total and longest wait, and (for mutexes) the longest hold time and last owner.
+ * This costs a few atomic updates and one or two SteadyClock reads per lock() and unlock(), so it
+ * is disabled by default. Locks can be ranked by contention with the 'os locks' CLI command. */
+//#define ENABLE_LOCK_STATISTICS
+
 namespace jel
 {
+
+/** @class LockStatistics
+ *  @brief Contention statistics for a single Lock, used to find the locks that convoy threads.
+ *
+ *  When ENABLE_LOCK_STATISTICS is defined each Lock holds a LockStatistics object, which adds
+ *  itself to a system wide table on construction and removes itself on destruction. The table is
+ *  read with snapshot(), which copies every entry while the scheduler is locked so that a Lock
+ *  being destroyed concurrently can't be read after it is gone.
+ *
+ *  A lock() call is contended if the lock was not immediately available; only the time then
+ *  spent blocked adds to the wait times. Hold times and owners are only
+ *  recorded for the mutex types, measured from the outermost lock() to the matching unlock() of a
+ *  RecursiveMutex. Operations from an ISR are not recorded.
+ *  */
+class LockStatistics
+{
+public:
+  /** Lock names longer than this (including a NULL terminator) will be truncated. */
+  static constexpr size_t maxNameLength_chars = 16;
+  /** A copy of one table entry, taken by snapshot(). */
+  struct Snapshot
+  {
+    const void* lock;
+    char name[maxNameLength_chars];
+    const char* kind;
+    uint32_t acquisitions;
+    uint32_t contended;
+    uint32_t timeouts;
+    uint64_t totalWait_us;
+    uint32_t maxWait_us;
+    uint32_t maxHold_us;
+    const void* lastOwner;
+  };
+  /** Registers the statistics of a lock in the system table. kind is a short, static description
+   * of the lock type. If tracksOwner is true, hold times and owners are recorded. */
+  LockStatistics(const void* lock, const char* kind, const bool tracksOwner) noexcept;
+  /** Removes the statistics from the system table. */
+  ~LockStatistics() noexcept;
+  LockStatistics(const LockStatistics&) = delete;
+  LockStatistics& operator=(const LockStatistics&) = delete;
+  void setName(const char* name) noexcept;
+  /** Records the outcome of a lock() call. waited is the time spent blocked, if contended. */
+  void recordLock(const bool acquired, const bool contended, const Duration& waited) noexcept;
+  /** Records an unlock(). Must be called while the lock is still held. */
+  void recordUnlock() noexcept;
+  /** Clears all counters and maximums. */
+  void reset() noexcept;
+  const char* name() const noexcept { return name_; }
+  const char* kind() const noexcept { return kind_; }
+  uint32_t acquisitions() const noexcept { return acquisitions_; }
+  /** lock() calls that found the lock unavailable, whether they then acquired it or not. */
+  uint32_t contended() const noexcept { return contended_; }
+  /** lock() calls that failed because the lock stayed unavailable until the timeout expired. */
+  uint32_t timeouts() const noexcept { return timeouts_; }
+  uint64_t totalWait_us() const noexcept { return totalWait_us_; }
+  uint32_t maxWait_us() const noexcept { return maxWait_us_; }
+  uint32_t maxHold_us() const noexcept { return maxHold_us_; }
+  /** The RTOS handle of the thread that last acquired the lock, or a nullptr if not tracked. */
+  const void* lastOwner() const noexcept { return lastOwner_; }
+  /** Copies up to maxLocks table entries into snapshots, returning the number copied. */
+  static size_t snapshot(Snapshot* snapshots, const size_t maxLocks) noexcept;
+  /** Returns the number of locks currently in the table. */
+  static size_t registeredLocks() noexcept;
+  /** Clears the counters of every lock in the table. */
+  static void resetAll() noexcept;
+private:
+  const void* lock_;
+  const char* kind_;
+  const bool tracksOwner_;
+  std::atomic<uint32_t> acquisitions_;
+  std::atomic<uint32_t> contended_;
+  std::atomic<uint32_t> timeouts_;
+  std::atomic<uint32_t> maxWait_us_;
+  std::atomic<uint32_t> maxHold_us_;
+  std::atomic<const void*> lastOwner_;
+  /** Only updated within a CriticalSection, as 64 bit atomics are not lock free on all targets. */
+  uint64_t totalWait_us_;
+  /** Owner only state, used to time holds. */
+  uint32_t holdDepth_;
+  Timestamp holdStart_;
+  char name_[maxNameLength_chars];
+  LockStatistics* next_;
+  static LockStatistics* tableStart_;
+  void copyTo(Snapshot& snap) const noexcept;
+};
+
 /** @class Lock
 *  @brief Provides a thread-safe locking primitive.
 *
 *  Lock implements a generic lock object. Typically it is recommended to use one of the specialized
 *  child variants instead, such as Mutex or Semaphore. 
 *  @note Lock objects do not support copy construction, but may be moved.
-*  @note Locks may be instantiated either on the stack or via an allocator. A lock requires ~88B of
+*  @note Locks may be instantiated either on the stack or via an allocator. A lock requires ~92B of
 *  memory under full optimization.
 *  */
 class Lock
@@ -73,6 +172,9 @@ public:
     /** Recursive style mutex appropriate for ensuring a single thread can repeatedly 'acquire' a 
      * given resource. NOTE: Not usable in ISRs. */
     recursiveMutex,
+    /** A mutex that is acquired and released with a single atomic operation when uncontended, see
+     * FastMutex. NOTE: Not usable in ISRs. */
+    fastMutex,
   };
   /**< The Lock_Base parent constructor performs no actions. The lock must be created via the Lock
    * classes. */
@@ -91,17 +193,29 @@ public:
    * increasing the count for a counting semaphore. If the lock is
   * currently free or at its maximum count, this function will have no effect. */
   void unlock() noexcept;
+  /** Sets the name shown by the 'os locks' CLI command. Has no effect unless
+   * ENABLE_LOCK_STATISTICS is defined. */
+  void setName(const char* name) noexcept;
+  /** Returns the statistics of this lock, or a nullptr if ENABLE_LOCK_STATISTICS is not
+   * defined. */
+  const LockStatistics* statistics() const noexcept;
   /** Returns true if two locks are identical. */
   bool operator==(const Lock& other) const noexcept { return handle_ == other.handle_; }
   /** Returns true if two locks are not identical. */
   bool operator!=(const Lock& other) const noexcept { return !(*this == other); }
 protected:
-  static constexpr size_t LockMemorySize_Bytes = 80;
+  friend class WaitSet;
+  static constexpr size_t LockMemorySize_Bytes = 84;
   using Handle = void*; 
   using StaticMemoryBlock = uint8_t[LockMemorySize_Bytes]; 
   Type type_;
   Handle handle_; 
   StaticMemoryBlock staticMemory_ __attribute__((aligned(4))); 
+#ifdef ENABLE_LOCK_STATISTICS
+  LockStatistics stats_;
+#endif
+  /** Takes the lock from thread context, without recording statistics. */
+  Status take(const Duration& timeout) noexcept;
 };
 
 class Semaphore : public Lock
@@ -150,6 +264,76 @@ public:
   RecursiveMutex& operator=(RecursiveMutex&& rhs) = delete;
 };
 
+/** @class FastMutex
+ *  @brief A mutex whose uncontended lock and unlock are a single atomic compare-exchange.
+ *
+ *  Most mutexes are almost never contended, yet every Mutex lock() and unlock() is a full RTOS
+ *  semaphore operation. A FastMutex instead holds its state in one atomic word: the owning thread's
+ *  handle, plus a flag that is set once another thread has had to wait. Only a thread that finds
+ *  the mutex owned enters the RTOS, setting the flag and parking on the underlying semaphore; the
+ *  owner then sees the flag in unlock() and wakes it.
+ *
+ *  Priority inheritance is preserved: a waiting thread raises the owner to its own priority before
+ *  parking. A thread may be raised through several FastMutexes at once, so its base priority is
+ *  only restored when it unlocks the last of them. The mutex is not recursive.
+ *
+ *  A FastMutex is a Lock, so it can be used with a LockGuard. Calls made directly on a FastMutex
+ *  are inlined, while calls through a Lock reference are forwarded from Lock::lock()/unlock().
+ *  @note The priority of a thread holding a FastMutex should not be changed by the application
+ *  while it is boosted, as its priority from before the first boost is restored on unlock().
+ *  */
+class FastMutex : public Lock
+{
+public:
+  FastMutex() : Lock(Type::fastMutex) { }
+  FastMutex(FastMutex& other) = delete; 
+  FastMutex(FastMutex&& other)  = delete;
+  FastMutex& operator=(FastMutex& rhs) = delete; 
+  FastMutex& operator=(FastMutex&& rhs)  = delete;
+  Status lock(const Duration& timeout = Duration::max()) noexcept
+  {
+    uintptr_t expected = 0;
+    if(state_.compare_exchange_strong(expected, currentThread(), std::memory_order_acquire,
+      std::memory_order_relaxed))
+    {
+#ifdef ENABLE_LOCK_STATISTICS
+      stats_.recordLock(true, false, Duration::zero());
+#endif
+      return Status::success;
+    }
+    return lockContended(timeout);
+  }
+  void unlock() noexcept
+  {
+#ifdef ENABLE_LOCK_STATISTICS
+    stats_.recordUnlock();
+#endif
+    uintptr_t owned = state_.load(std::memory_order_relaxed);
+    if(((owned & contendedFlag) == 0) &&
+      state_.compare_exchange_strong(owned, 0, std::memory_order_release,
+        std::memory_order_relaxed))
+    {
+      return;
+    }
+    unlockContended();
+  }
+  bool isLocked() const noexcept { return state_.load(std::memory_order_relaxed) != 0; }
+private:
+  /** Set in the state word when a thread may be parked waiting for the mutex. Thread handles are
+   * always word aligned, so the low bit of a handle is free. */
+  static constexpr uintptr_t contendedFlag = 0x1;
+  std::atomic<uintptr_t> state_{0};
+  /** Set while a waiting thread has a higher priority than the owner's base priority, in which
+   * case the mutex is counted in the owner's inheritance record. Only accessed with the scheduler
+   * locked. */
+  bool boosted_ = false;
+  static uintptr_t currentThread() noexcept;
+  Status lockContended(const Duration& timeout) noexcept;
+  Status acquireContended(const Duration& timeout, bool& waited) noexcept;
+  void unlockContended() noexcept;
+  void inheritPriority(const uintptr_t owner) noexcept;
+};
+
 class LockGuard
 {
 public:
@@ -202,4 +386,210 @@ protected:
   bool locked_;
 };
 
+/** @class SharedMutex
+ *  @brief A reader-writer lock, allowing any number of readers or a single writer.
+ *
+ *  Data that is read by many threads and rarely written (configuration tables, routing maps, etc.)
+ *  serializes every reader when protected by a Mutex. A SharedMutex lets readers, which take it
+ *  with lock_shared(), hold it at the same time, while a writer taking it with lock() still has
+ *  exclusive access.
+ *
+ *  Writers are preferred: once a writer is waiting, new readers block until it has acquired and
+ *  released the lock, so a steady stream of readers cannot starve writers. Readers only touch an
+ *  atomic counter unless a writer is waiting or active. Blocked readers wait on an EventGroup, so
+ *  all of them are released together when the writer unlocks, and the writer waits for the last
+ *  reader to leave on a semaphore.
+ *  @note The lock is not recursive in either mode, and may not be used from an ISR. Writers
+ *  receive priority inheritance from each other, as they are serialized with a Mutex, but readers
+ *  do not pass their priority on to a writer, nor a writer to readers.
+ *  */
+class SharedMutex
+{
+public:
+  SharedMutex();
+  SharedMutex(const SharedMutex&) = delete;
+  SharedMutex(SharedMutex&&) = delete;
+  SharedMutex& operator=(const SharedMutex&) = delete;
+  SharedMutex& operator=(SharedMutex&&) = delete;
+  /** Acquires exclusive (writer) ownership within the timeout. */
+  Status lock(const Duration& timeout = Duration::max()) noexcept;
+  void unlock() noexcept;
+  /** Acquires shared (reader) ownership within the timeout. */
+  Status lock_shared(const Duration& timeout = Duration::max()) noexcept;
+  void unlock_shared() noexcept;
+  /** Returns the number of readers currently holding the lock. */
+  uint32_t readers() const noexcept { return state_.load(std::memory_order_relaxed) & ~writerFlag; }
+private:
+  /** Set while a writer is waiting for, or holding, the lock. The remaining bits count readers. */
+  static constexpr uint32_t writerFlag = 0x8000'0000;
+  /** Set in noWriter_ while writerFlag is clear. */
+  static constexpr EventGroup::Bits noWriterBit = 0x1;
+  std::atomic<uint32_t> state_;
+  /** Serializes writers. */
+  Mutex writerLock_;
+  /** Given by the last reader to leave while a writer waits. */
+  CountingSemaphore drained_;
+  EventGroup noWriter_;
+};
+
+/** @class SharedLockGuard
+ *  @brief An RAII guard holding a SharedMutex in shared (reader) mode. Behaves as a LockGuard.
+ *  */
+class SharedLockGuard
+{
+public:
+  SharedLockGuard(SharedMutex* mutexPtr, const Duration& timeout = Duration::max()) noexcept :
+    mutex_(mutexPtr), locked_(false)
+  {
+    retryLock(timeout);
+  }
+  SharedLockGuard(SharedMutex& mutexRef, const Duration& timeout = Duration::max()) noexcept :
+    SharedLockGuard(&mutexRef, timeout) {}
+  ~SharedLockGuard() noexcept { release(); }
+  SharedLockGuard(const SharedLockGuard& other) = delete;
+  SharedLockGuard(SharedLockGuard&& other) noexcept : mutex_(other.mutex_), locked_(other.locked_)
+  {
+    other.mutex_ = nullptr; other.locked_ = false;
+  }
+  SharedLockGuard& operator=(const SharedLockGuard& rhs) = delete;
+  SharedLockGuard& operator=(SharedLockGuard&& other) noexcept
+  {
+    release();
+    mutex_ = other.mutex_; locked_ = other.locked_;
+    other.mutex_ = nullptr; other.locked_ = false;
+    return *this;
+  }
+  /** If the SharedLockGuard acquired the lock successfully, this will return true. */
+  bool isLocked() const noexcept { return locked_; }
+  /** If the lock was not acquired on instantiation, calling this will attempt to capture it. */
+  Status retryLock(const Duration& timeout) noexcept
+  {
+    if(mutex_ == nullptr) { return Status::failure; }
+    if(locked_) { return Status::success; }
+    locked_ = (mutex_->lock_shared(timeout) == Status::success);
+    return locked_ ? Status::success : Status::failure;
+  }
+  /** Manually release the underlying lock. */
+  Status release() noexcept
+  {
+    if(mutex_ && locked_) { mutex_->unlock_shared(); locked_ = false; return Status::success; }
+    return Status::failure;
+  }
+private:
+  SharedMutex* mutex_;
+  bool locked_;
+};
+
+/** @class ExclusiveLockGuard
+ *  @brief An RAII guard holding a SharedMutex in exclusive (writer) mode. Behaves as a LockGuard.
+ *  */
+class ExclusiveLockGuard
+{
+public:
+  ExclusiveLockGuard(SharedMutex* mutexPtr, const Duration& timeout = Duration::max()) noexcept :
+    mutex_(mutexPtr), locked_(false)
+  {
+    retryLock(timeout);
+  }
+  ExclusiveLockGuard(SharedMutex& mutexRef, const Duration& timeout = Duration::max()) noexcept :
+    ExclusiveLockGuard(&mutexRef, timeout) {}
+  ~ExclusiveLockGuard() noexcept { release(); }
+  ExclusiveLockGuard(const ExclusiveLockGuard& other) = delete;
+  ExclusiveLockGuard(ExclusiveLockGuard&& other) noexcept :
+    mutex_(other.mutex_), locked_(other.locked_)
+  {
+    other.mutex_ = nullptr; other.locked_ = false;
+  }
+  ExclusiveLockGuard& operator=(const ExclusiveLockGuard& rhs) = delete;
+  ExclusiveLockGuard& operator=(ExclusiveLockGuard&& other) noexcept
+  {
+    release();
+    mutex_ = other.mutex_; locked_ = other.locked_;
+    other.mutex_ = nullptr; other.locked_ = false;
+    return *this;
+  }
+  /** If the ExclusiveLockGuard acquired the lock successfully, this will return true. */
+  bool isLocked() const noexcept { return locked_; }
+  /** If the lock was not acquired on instantiation, calling this will attempt to capture it. */
+  Status retryLock(const Duration& timeout) noexcept
+  {
+    if(mutex_ == nullptr) { return Status::failure; }
+    if(locked_) { return Status::success; }
+    locked_ = (mutex_->lock(timeout) == Status::success);
+    return locked_ ? Status::success : Status::failure;
+  }
+  /** Manually release the underlying lock. */
+  Status release() noexcept
+  {
+    if(mutex_ && locked_) { mutex_->unlock(); locked_ = false; return Status::success; }
+    return Status::failure;
+  }
+private:
+  SharedMutex* mutex_;
+  bool locked_;
+};
+
+/** @class Notification
+ *  @brief A signal from an ISR or thread to a single waiting thread, built on task notifications.
+ *
+ *  A Notification replaces a Semaphore for the common case where one thread waits for an event
+ *  raised by an interrupt or another thread, such as a driver's transfer complete flag. The waiting
+ *  thread is woken with an RTOS task notification, which is considerably faster than a semaphore
+ *  give/take and needs no RTOS control block; a Notification is 12B instead of the ~92B of a
+ *  Semaphore. The notification state itself is held in the object, so signals raised before a
+ *  thread waits are not lost, and unrelated task notifications (for example, from an SpscQueue)
+ *  are treated as spurious wakeups.
+ *
+ *  The Mode selects how notify() and wait() behave:
+ *    -binary: notify() sets the notification and wait() clears it. Multiple notify() calls before
+ *    a wait() are merged into one.
+ *    -counting: notify() increments a count and wait() decrements it.
+ *    -bits: notify(bits) sets flag bits, and waitBits() waits for and clears any bits in a mask.
+ *  @note Only one thread may wait on a Notification at a time, although any number of threads and
+ *  ISRs may notify it. notify() is ISR safe; the wait functions may not be called from an ISR
+ *  except with a zero timeout.
+ *  */
+class Notification
+{
+public:
+  enum class Mode : uint8_t
+  {
+    binary,
+    counting,
+    bits
+  };
+  /** Construct a Notification. initialValue is the initial state of the notification, i.e. 1 for
+   * a binary notification that starts set, the initial count or the initial flag bits. */
+  constexpr Notification(const Mode mode = Mode::binary, const uint32_t initialValue = 0) noexcept :
+    value_{initialValue}, waiter_{nullptr}, mode_{mode} {}
+  Notification(const Notification&) = delete;
+  Notification(Notification&&) = delete;
+  Notification& operator=(const Notification&) = delete;
+  Notification& operator=(Notification&&) = delete;
+  /** Raises the notification, waking the waiting thread if there is one. In bits mode, bits are
+   * the flags to set; otherwise bits is ignored. */
+  void notify(const uint32_t bits = 1) noexcept;
+  /** Waits up to timeout for the notification. In binary mode it is cleared, in counting mode the
+   * count is decremented and in bits mode all pending bits are cleared. */
+  Status wait(const Duration& timeout = Duration::max()) noexcept;
+  /** Waits up to timeout for the notification without consuming it. This suits level style
+   * 'operation complete' flags, which may be checked any number of times once set. */
+  Status waitUntilSet(const Duration& timeout = Duration::max()) noexcept;
+  /** Waits up to timeout for any of the bits in mask to be set. The set bits within mask are
+   * returned and cleared; 0 is returned on a timeout. */
+  uint32_t waitBits(const uint32_t mask, const Duration& timeout = Duration::max()) noexcept;
+  /** Clears the notification without waiting. */
+  void clear() noexcept { value_ = 0; }
+  /** Returns the current notification value: the flag, count or bits, depending on the Mode. */
+  uint32_t value() const noexcept { return value_; }
+  Mode mode() const noexcept { return mode_; }
+private:
+  std::atomic<uint32_t> value_;
+  std::atomic<void*> waiter_;
+  const Mode mode_;
+  /** Blocks until tryTake returns true or the timeout expires. */
+  template<typename TryFn>
+  bool block(TryFn&& tryTake, const Duration& timeout) noexcept;
+};
+
 } /** namespace jel */
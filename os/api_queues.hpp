@@ -9,7 +9,11 @@
  *    larger volumes of data be transferred. Instead, it is often more memory efficient to have a
  *    producer and consumer queue where the consumer receives pointers to data to process, feeding
  *    them back to the producer queue when done. This does result in the overhead of an additional
- *    Queue (80B + (max number of pointers * 4B)) but removes the requirement for large data copies.
+ *    Queue (84B + (max number of pointers * 4B)) but removes the requirement for large data copies.
+ *
+ *    A Queue allocates its item storage from the heap and releases it on destruction. A
+ *    StaticQueue holds its storage inline and never touches the heap. Both report their memory
+ *    cost at compile time through footprint_Bytes().
  *
  *  @author Jonathan Thomson 
  */
@@ -37,13 +41,114 @@
 #pragma once
 
 /** C/C++ Standard Library Headers */
+#include <atomic>
+#include <cstddef>
+#include <functional>
 #include <memory>
+#include <new>
+#include <utility>
 /** jel Library Headers */
 #include "os/api_common.hpp"
 #include "os/api_time.hpp"
+#include "os/api_locks.hpp"
+#include "os/api_system.hpp"
+
+/** When defined, every Queue and StaticQueue keeps a QueueStatistics record of its push/pop
+ * counts, failures, maximum depth and the time spent blocked waiting for space or data. This costs
+ * a few atomic updates and a queue depth read per operation, plus two SteadyClock reads for each
+ * operation that has to block, so it is disabled by default. The statistics can be viewed with the
+ * 'os queues' CLI command. */
+//#define ENABLE_QUEUE_STATISTICS
 
 namespace jel
 {
+
+/** @class QueueStatistics
+ *  @brief Usage statistics for a single Queue, used to size queues and locate backpressure.
+ *
+ *  When ENABLE_QUEUE_STATISTICS is defined each Queue holds a QueueStatistics object, which adds
+ *  itself to a system wide table on construction and removes itself on destruction. The table is
+ *  read with snapshot(), which copies every entry while the scheduler is locked so that a Queue
+ *  being destroyed concurrently can't be read after it is gone.
+ *
+ *  Blocking waits are timed only once an operation has failed to complete immediately, so the
+ *  wait histogram counts real blocking rather than every call with a non-zero timeout. A push
+ *  (or pop) that waits and then still times out is counted both as a wait and as a failure.
+ *  */
+class QueueStatistics
+{
+public:
+  /** Queue names longer than this (including a NULL terminator) will be truncated. */
+  static constexpr size_t maxNameLength_chars = 16;
+  static constexpr size_t waitHistogramBins = 6;
+  /** The exclusive upper bound of each wait histogram bin, in microseconds. The final bin counts
+   * every wait of one second or longer. */
+  static constexpr int64_t waitBinLimits_us[waitHistogramBins - 1] =
+    {100, 1'000, 10'000, 100'000, 1'000'000};
+  /** A copy of one table entry, taken by snapshot(). */
+  struct Snapshot
+  {
+    const void* queue;
+    char name[maxNameLength_chars];
+    size_t capacity;
+    size_t depth;
+    size_t maxDepth;
+    uint32_t pushes;
+    uint32_t pops;
+    uint32_t pushFailures;
+    uint32_t popFailures;
+    uint32_t waits[waitHistogramBins];
+  };
+  /** Registers the statistics of a queue holding at most capacity elements in the system table. */
+  QueueStatistics(const size_t capacity) noexcept;
+  /** Removes the statistics from the system table. */
+  ~QueueStatistics() noexcept;
+  QueueStatistics(const QueueStatistics&) = delete;
+  QueueStatistics& operator=(const QueueStatistics&) = delete;
+  /** Associates the RTOS queue whose current depth is reported by snapshot(). */
+  void attach(const void* queueHandle) noexcept { queue_ = queueHandle; }
+  void setName(const char* name) noexcept;
+  void recordPush(const size_t count, const size_t depth) noexcept;
+  void recordPop(const size_t count) noexcept;
+  void recordFailure(const bool isPush) noexcept;
+  void recordWait(const Duration& waited) noexcept;
+  /** Clears all counters. The maximum depth restarts from zero. */
+  void reset() noexcept;
+  const char* name() const noexcept { return name_; }
+  /** The RTOS handle of the queue these statistics belong to. */
+  const void* queue() const noexcept { return queue_; }
+  size_t capacity() const noexcept { return capacity_; }
+  /** The largest number of elements the queue has held since construction or the last reset(). */
+  size_t maxDepth() const noexcept { return maxDepth_; }
+  uint32_t pushes() const noexcept { return pushes_; }
+  uint32_t pops() const noexcept { return pops_; }
+  /** Pushes that failed because the queue stayed full until the timeout expired. */
+  uint32_t pushFailures() const noexcept { return pushFailures_; }
+  /** Pops that failed because the queue stayed empty until the timeout expired. */
+  uint32_t popFailures() const noexcept { return popFailures_; }
+  /** The number of blocking waits whose duration fell into the given histogram bin. */
+  uint32_t waits(const size_t bin) const noexcept { return waits_[bin]; }
+  /** Copies up to maxQueues table entries into snapshots, returning the number copied. */
+  static size_t snapshot(Snapshot* snapshots, const size_t maxQueues) noexcept;
+  /** Returns the number of queues currently in the table. */
+  static size_t registeredQueues() noexcept;
+  /** Clears the counters of every queue in the table. */
+  static void resetAll() noexcept;
+private:
+  const void* queue_;
+  size_t capacity_;
+  std::atomic<size_t> maxDepth_;
+  std::atomic<uint32_t> pushes_;
+  std::atomic<uint32_t> pops_;
+  std::atomic<uint32_t> pushFailures_;
+  std::atomic<uint32_t> popFailures_;
+  std::atomic<uint32_t> waits_[waitHistogramBins];
+  char name_[maxNameLength_chars];
+  QueueStatistics* next_;
+  static QueueStatistics* tableStart_;
+  void copyTo(Snapshot& snap) const noexcept;
+};
+
 /** @class GenericCopyQueue_Base
  *  @brief This base class is used strictly as a helper and should not be used in the application
  *  directly.
@@ -56,15 +161,33 @@ protected:
   Status genericPush(const void* item, const Duration& timeout) noexcept;
   Status genericPushToFront(const void* item, const Duration& timeout) noexcept;
   Status genericPop(void* item, const Duration& timeout) noexcept;
+  size_t genericPushN(const void* items, const size_t count, const Duration& timeout) noexcept;
+  size_t genericPopN(void* items, const size_t maxCount, const Duration& timeout) noexcept;
   size_t genericGetSize() const noexcept;
   size_t genericGetFreeSpace() const noexcept;
   void genericErase() noexcept;
+  void genericSetName(const char* name) noexcept;
+  const QueueStatistics* genericStatistics() const noexcept;
 private:
-  using CbStorage = uint8_t[80];
+  friend class WaitSet;
+  using CbStorage = uint8_t[84];
   using Handle = void*;
   Handle handle_;
   CbStorage cbMemory_ __attribute__((aligned(4)));
   uint8_t* itemStoragePtr_;
+  size_t itemSize_;
+#ifdef ENABLE_QUEUE_STATISTICS
+  QueueStatistics stats_;
+#endif
+  size_t pushBatch(const uint8_t* items, const size_t count) noexcept;
+  size_t popBatch(uint8_t* items, const size_t maxCount) noexcept;
+  /** Runs a blocking RTOS queue operation, timing the wait when statistics are enabled. op is
+   * called with a tick timeout and returns true on success. */
+  template<typename Op>
+  bool blockingOp(Op&& op, const Duration& timeout) noexcept;
+  void recordPush(const size_t count) noexcept;
+  void recordPop(const size_t count) noexcept;
+  void recordFailure(const bool isPush) noexcept;
 };
 
 /** @class Queue
@@ -90,15 +213,19 @@ private:
 class QueueMemoryHelper
 {
 public:
-  QueueMemoryHelper(size_t memSize_Bytes) 
-  {
-    itemMemory_ = new uint8_t[memSize_Bytes];
-    needToFree_ = true;
-  }
-  QueueMemoryHelper(uint8_t* memory)
+  /** Allocate memSize_Bytes of item storage from the heap. It is released on destruction. */
+  QueueMemoryHelper(size_t memSize_Bytes) : 
+    itemMemory_{new uint8_t[memSize_Bytes]}, needToFree_{true} {}
+  /** Use externally owned item storage. No heap allocation is performed. */
+  QueueMemoryHelper(uint8_t* memory) noexcept : itemMemory_{memory}, needToFree_{false} {}
+  QueueMemoryHelper(const QueueMemoryHelper&) = delete;
+  QueueMemoryHelper& operator=(const QueueMemoryHelper&) = delete;
+  ~QueueMemoryHelper() noexcept
   {
-    itemMemory_ = memory;
-    needToFree_ = false;
+    if(needToFree_)
+    {
+      delete[] itemMemory_;
+    }
   }
   uint8_t* itemMemory_;
 private:
@@ -108,16 +235,42 @@ private:
 template<typename T, bool isTrivial = std::is_trivially_copyable<T>::value>
 class Queue : private QueueMemoryHelper, private GenericCopyQueue_Base
 {
+  friend class WaitSet;
   template<bool cond, typename U>
   using ResolvedType = typename std::enable_if<cond, U>::type;
+  static_assert(alignof(T) <= alignof(std::max_align_t),
+    "Over-aligned queue items are not supported.");
 protected:
+  /** Construct a Queue on top of externally owned item storage. memory must be at least
+   * itemStorage_Bytes(maxNumberOfElements) long, aligned for T, and outlive the Queue. */
   Queue(const size_t maxNumberOfElements, uint8_t* memory) : 
-    QueueMemoryHelper(maxNumberOfElements * sizeof(T)),
+    QueueMemoryHelper(memory),
     GenericCopyQueue_Base(maxNumberOfElements, sizeof(T), memory) {}
 public:
-  Queue(const size_t maxNumberOfElements) : QueueMemoryHelper(maxNumberOfElements * sizeof(T)),
+  /** Construct a Queue, allocating its item storage from the heap. */
+  Queue(const size_t maxNumberOfElements) :
+    QueueMemoryHelper(itemStorage_Bytes(maxNumberOfElements)),
     GenericCopyQueue_Base(maxNumberOfElements, sizeof(T), itemMemory_) {}
-  ~Queue() noexcept {}
+  ~Queue() noexcept
+  {
+    //Elements still held by the queue are owned by it and must be destroyed.
+    if constexpr(!std::is_trivially_destructible<T>::value)
+    {
+      while(consume([](T&) {}, Duration::zero()) == Status::success);
+    }
+  }
+  /** Bytes of item storage required for a Queue holding maxNumberOfElements. */
+  static constexpr size_t itemStorage_Bytes(size_t maxNumberOfElements) noexcept
+  {
+    return maxNumberOfElements * sizeof(T);
+  }
+  /** Total RAM used by a heap backed Queue holding maxNumberOfElements, i.e. the Queue object
+   * (including the RTOS control block) plus its heap allocated item storage. Allocator block
+   * overhead is not included. */
+  static constexpr size_t footprint_Bytes(size_t maxNumberOfElements) noexcept
+  {
+    return sizeof(Queue) + itemStorage_Bytes(maxNumberOfElements);
+  }
   //If the underlying queue object is trivially copyable, simply pass the pointer off to the
   //underlying implementation which will memcpy the value.
   template<typename U = Status>
@@ -138,95 +291,738 @@ public:
     static_assert(std::is_trivially_copyable<T>::value, "Queue object is not trivially copyable!");
     return genericPop(&item, timeout);
   }
-  //If the underlying queue object is not trivially copyable, some more work has to be done to
-  //trigger a move constructor. Note that this won't work for objects that have their address
-  //tracked in another object and update it via a move constructor, because once the move
-  //constructor is called a deep copy is performed and the data is now locked into the queue and
-  //cannot be touched. Once it is moved out of the queue, another deep copy is performed and that
-  //memory is then moved from. This allows the use of most objects like smart pointers without
-  //issue, but can cause problems if a linked list item is placed into the queue because the other
-  //list pointers are pointing to some random chunk of stack memory after the push operation.
+  /** Pushes up to count items in one batch, returning the number pushed. If the queue is full,
+   * waits up to timeout for space for the first item; the remaining items are only pushed if
+   * there is space for them immediately. A consumer woken by the batch is switched to once, after
+   * the whole batch has been queued, rather than once per item. */
+  template<typename U = size_t>
+  ResolvedType<isTrivial, U> pushN(const T* items, const size_t count,
+    const Duration& timeout = Duration::max()) noexcept
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "Queue object is not trivially copyable!");
+    return genericPushN(items, count, timeout);
+  }
+  /** Pops up to maxCount items into items in one batch, returning the number popped. If the queue
+   * is empty, waits up to timeout for the first item and then takes whatever else is available
+   * without blocking again. */
+  template<typename U = size_t>
+  ResolvedType<isTrivial, U> popN(T* items, const size_t maxCount,
+    const Duration& timeout = Duration::max()) noexcept
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "Queue object is not trivially copyable!");
+    return genericPopN(items, maxCount, timeout);
+  }
+  //If the underlying queue object is not trivially copyable, its bytes are relocated into and out
+  //of the queue storage: the element is constructed once in a local slot, memcpy'd into the queue
+  //(which then owns it), and memcpy'd back out into a raw local slot on pop, where it is moved to
+  //the caller and destroyed. No default construction is required. Note that this won't work for
+  //objects that have their address tracked in another object and update it via a move
+  //constructor, as the relocation is a plain memcpy. This allows the use of most objects like
+  //smart pointers without issue, but can cause problems if a linked list item is placed into the
+  //queue because the other list pointers are pointing to some random chunk of stack memory after
+  //the push operation.
   template<typename U = Status>
   ResolvedType<!isTrivial, U> push(T&& item, const Duration& timeout = Duration::max()) 
   {
     static_assert(!std::is_trivially_copyable<T>::value, "Queue object is trivially copyable!");
-    uint8_t tempMemory[sizeof(T)] __attribute__((aligned(4)));
-    //TODO: Check if default construction can be eliminated in favour of raw ptr.
-    T* tPtr = new (tempMemory) T();
-    *tPtr = std::move(item);
-    return genericPush(tPtr, timeout);
+    return relocateIn(item, false, timeout);
   }
   template<typename U = Status>
   ResolvedType<!isTrivial, U> push(T& item, const Duration& timeout = Duration::max()) 
   {
     static_assert(!std::is_trivially_copyable<T>::value, "Queue object is trivially copyable!");
-    uint8_t tempMemory[sizeof(T)] __attribute__((aligned(4)));
-    //TODO: Check if default construction can be eliminated in favour of raw ptr.
-    T* tPtr = new (tempMemory) T();
-    *tPtr = std::move(item);
-    return genericPush(tPtr, timeout);
+    return relocateIn(item, false, timeout);
   }
   template<typename U = Status>
   ResolvedType<!isTrivial, U> pushToFront(T&& item, const Duration& timeout = Duration::max())
   {
     static_assert(!std::is_trivially_copyable<T>::value, "Queue object is trivially copyable!");
-    uint8_t tempMemory[sizeof(T)] __attribute__((aligned(4)));
-    T* tPtr = new (tempMemory) T(); //TODO: See push(T&&)
-    *tPtr = std::move(item);
-    return genericPushToFront(tPtr, timeout);
+    return relocateIn(item, true, timeout);
   }
   template<typename U = Status>
   ResolvedType<!isTrivial, U> pushToFront(T& item, const Duration& timeout = Duration::max())
   {
     static_assert(!std::is_trivially_copyable<T>::value, "Queue object is trivially copyable!");
-    uint8_t tempMemory[sizeof(T)] __attribute__((aligned(4)));
-    T* tPtr = new (tempMemory) T(); //TODO: See push(T&&)
-    *tPtr = std::move(item);
-    return genericPushToFront(tPtr, timeout);
+    return relocateIn(item, true, timeout);
   }
   template<typename U = Status>
   ResolvedType<!isTrivial, U> pop(T&& item, const Duration& timeout = Duration::max())
   {
     static_assert(!std::is_trivially_copyable<T>::value, "Queue object is trivially copyable!");
-    uint8_t tempMemory[sizeof(T)] __attribute__((aligned(4)));
-    T* tPtr = new (tempMemory) T(); //TODO: See push(T&&)
-    if(genericPop(tPtr, timeout) == Status::success)
-    {
-      item = std::move(*tPtr);
-      return Status::success;
-    }
-    else
-    {
-      return Status::failure;
-    }
+    return consume([&](T& front) { item = std::move(front); }, timeout);
   }
   template<typename U = Status>
   ResolvedType<!isTrivial, U> pop(T& item, const Duration& timeout = Duration::max())
   {
     static_assert(!std::is_trivially_copyable<T>::value, "Queue object is trivially copyable!");
-    uint8_t tempMemory[sizeof(T)] __attribute__((aligned(4)));
-    T* tPtr = new (tempMemory) T(); //TODO: See push(T&&)
-    if(genericPop(tPtr, timeout) == Status::success)
+    return consume([&](T& front) { item = std::move(front); }, timeout);
+  }
+  /** Constructs an element from args directly in the slot that is copied into the queue. Unlike
+   * push(), T does not need to be default constructible or movable. Blocks until space is
+   * available. */
+  template<typename... Args>
+  Status emplace(Args&&... args)
+  {
+    return emplaceFor(Duration::max(), std::forward<Args>(args)...);
+  }
+  /** As emplace(), but waits at most timeout for space. On failure the constructed element is
+   * destroyed. */
+  template<typename... Args>
+  Status emplaceFor(const Duration& timeout, Args&&... args)
+  {
+    alignas(T) uint8_t slot[sizeof(T)];
+    T* tPtr = new (slot) T(std::forward<Args>(args)...);
+    if(genericPush(tPtr, timeout) != Status::success)
     {
-      item = std::move(*tPtr);
-      return Status::success;
+      tPtr->~T();
+      return Status::failure;
     }
-    else
+    //The queue now owns the element's bytes; the local slot must not be destroyed.
+    return Status::success;
+  }
+  /** Removes the front element and passes it by reference to fn, destroying it once fn returns.
+   * This hands the element to the consumer without any intermediate move or default constructed
+   * destination object. */
+  template<typename Fn>
+  Status consume(Fn&& fn, const Duration& timeout = Duration::max())
+  {
+    alignas(T) uint8_t slot[sizeof(T)];
+    if(genericPop(slot, timeout) != Status::success)
     {
       return Status::failure;
     }
+    T* tPtr = reinterpret_cast<T*>(slot);
+    auto destroy = ToScopeGuard([&]() { tPtr->~T(); });
+    fn(*tPtr);
+    return Status::success;
   }
   size_t size() const noexcept { return genericGetSize(); }
   bool empty() const noexcept { return genericGetSize() > 0 ? false : true; }
+  /** Returns the number of elements that can be pushed before the queue is full. */
+  size_t freeSpace() const noexcept { return genericGetFreeSpace(); }
+  /** Removes all elements from the queue. Non-trivially destructible elements are popped and
+   * destroyed one at a time; otherwise the queue is reset in a single operation. */
+  void clear() noexcept
+  {
+    if constexpr(!std::is_trivially_destructible<T>::value)
+    {
+      while(consume([](T&) {}, Duration::zero()) == Status::success);
+    }
+    else
+    {
+      genericErase();
+    }
+  }
+  /** Names the queue in the queue statistics table. This has no effect unless
+   * ENABLE_QUEUE_STATISTICS is defined. */
+  void setName(const char* name) noexcept { genericSetName(name); }
+  /** Returns the statistics of this queue, or a nullptr if ENABLE_QUEUE_STATISTICS is not
+   * defined. */
+  const QueueStatistics* statistics() const noexcept { return genericStatistics(); }
+private:
+  /** Relocates item into the queue, moving it back out if the push fails so the caller never
+   * loses the element. Types without a move constructor are default constructed and then move
+   * assigned. */
+  Status relocateIn(T& item, bool toFront, const Duration& timeout)
+  {
+    alignas(T) uint8_t slot[sizeof(T)];
+    T* tPtr;
+    if constexpr(std::is_move_constructible<T>::value)
+    {
+      tPtr = new (slot) T(std::move(item));
+    }
+    else
+    {
+      tPtr = new (slot) T();
+      *tPtr = std::move(item);
+    }
+    Status stat = toFront ? genericPushToFront(tPtr, timeout) : genericPush(tPtr, timeout);
+    if(stat != Status::success)
+    {
+      item = std::move(*tPtr);
+      tPtr->~T();
+    }
+    return stat;
+  }
 };
 
+/** @class StaticQueue
+ *  @brief A Queue whose item storage is held inline, for use as a global/static object.
+ *
+ *  A StaticQueue performs no heap allocation at all; the RTOS control block and all item storage
+ *  are members of the object. Its complete RAM cost is therefore known at compile time and is
+ *  reported by footprint_Bytes(), e.g.
+ *    static_assert(StaticQueue<Msg, 8>::footprint_Bytes() <= 256, "Queue budget exceeded.");
+ *  */
 template<typename T, size_t maxNumberOfElements, 
   bool isTrivial = std::is_trivially_copyable<T>::value>
-class StaticQueue : Queue<T, isTrivial>
+class StaticQueue : public Queue<T, isTrivial>
 {
-  uint8_t* staticMemory_[sizeof(T) * maxNumberOfElements] __attribute__((aligned(4)));
+  static_assert(maxNumberOfElements > 0, "A StaticQueue must hold at least one element.");
+  alignas(T) uint8_t staticMemory_[sizeof(T) * maxNumberOfElements];
 public:
   StaticQueue() : Queue<T, isTrivial>(maxNumberOfElements, staticMemory_) {}
+  /** Bytes of inline item storage held by this StaticQueue. */
+  static constexpr size_t itemStorage_Bytes() noexcept
+  {
+    return Queue<T, isTrivial>::itemStorage_Bytes(maxNumberOfElements);
+  }
+  /** Total RAM used by this StaticQueue. This is the entire cost, as no heap is used. */
+  static constexpr size_t footprint_Bytes() noexcept { return sizeof(StaticQueue); }
 };
 
+/** @class WaitSet
+ *  @brief Allows a single thread to block on several Queues and semaphores at once.
+ *
+ *  A WaitSet wraps an RTOS queue set. Queues, Semaphores and CountingSemaphores are registered
+ *  with add(), after which a single wait() call blocks until any one of them has data or is
+ *  available, and isReady() reports which member that was. This replaces polling several objects
+ *  with short timeouts, or dedicating one thread to each source.
+ *  @code
+ *    WaitSet ws{rxQueueLength + 1};
+ *    ws.add(rxQueue);
+ *    ws.add(stopSignal);
+ *    while(ws.wait() == Status::success)
+ *    {
+ *      if(ws.isReady(rxQueue)) { rxQueue.pop(msg, Duration::zero()); }
+ *      else if(ws.isReady(stopSignal)) { stopSignal.lock(Duration::zero()); break; }
+ *    }
+ *  @endcode
+ *
+ *  @note The eventCapacity given at construction must be at least the sum of the lengths of all
+ *  members (1 for a Semaphore, the maximum count for a CountingSemaphore).
+ *  @note A Queue may only be added or removed while it is empty, and a semaphore only while it is
+ *  not available. All members must be removable (i.e. drained) when the WaitSet is destroyed.
+ *  @note Each successful wait() must be followed by exactly one zero timeout pop()/lock() of the
+ *  ready member, and members should not be read except as directed by wait().
+ *  @note Mutexes cannot be members, as they would lose priority inheritance. The lock-free
+ *  SpscQueue/MpmcQueue are not RTOS objects and cannot be members either.
+ *  @note The underlying queue set is allocated from the system heap.
+ *  */
+class WaitSet
+{
+public:
+  /** The maximum number of objects that may be registered with a single WaitSet. */
+  static constexpr size_t maxMembers = 8;
+  WaitSet(const size_t eventCapacity);
+  ~WaitSet() noexcept;
+  WaitSet(const WaitSet&) = delete;
+  WaitSet& operator=(const WaitSet&) = delete;
+  template<typename T, bool isTrivial>
+  Status add(Queue<T, isTrivial>& queue) noexcept
+  {
+    return addMember(queue.GenericCopyQueue_Base::handle_);
+  }
+  Status add(Semaphore& semaphore) noexcept { return addMember(semaphore.handle_); }
+  Status add(CountingSemaphore& semaphore) noexcept { return addMember(semaphore.handle_); }
+  template<typename T, bool isTrivial>
+  Status remove(Queue<T, isTrivial>& queue) noexcept
+  {
+    return removeMember(queue.GenericCopyQueue_Base::handle_);
+  }
+  Status remove(Semaphore& semaphore) noexcept { return removeMember(semaphore.handle_); }
+  Status remove(CountingSemaphore& semaphore) noexcept { return removeMember(semaphore.handle_); }
+  /** Blocks until any member is ready, or the timeout expires. From an ISR this never blocks. */
+  Status wait(const Duration& timeout = Duration::max()) noexcept;
+  /** Returns true if the given member was the one selected by the last successful wait(). */
+  template<typename T, bool isTrivial>
+  bool isReady(const Queue<T, isTrivial>& queue) const noexcept
+  {
+    return (ready_ != nullptr) && (ready_ == queue.GenericCopyQueue_Base::handle_);
+  }
+  bool isReady(const Semaphore& semaphore) const noexcept
+  {
+    return (ready_ != nullptr) && (ready_ == semaphore.handle_);
+  }
+  bool isReady(const CountingSemaphore& semaphore) const noexcept
+  {
+    return (ready_ != nullptr) && (ready_ == semaphore.handle_);
+  }
+  /** The number of objects currently registered. */
+  size_t size() const noexcept { return memberCount_; }
+private:
+  using Handle = void*;
+  Handle handle_;
+  Handle ready_;
+  Handle members_[maxMembers];
+  size_t memberCount_;
+  Status addMember(Handle member) noexcept;
+  Status removeMember(Handle member) noexcept;
+};
+
+/** @class SpscQueue_Base
+ *  @brief This base class is used strictly as a helper and should not be used in the application
+ *  directly. It holds the RTOS dependent consumer wakeup logic shared by all SpscQueues.
+ * */
+class SpscQueue_Base
+{
+protected:
+  SpscQueue_Base() noexcept : consumer_{nullptr} {}
+  /** Blocks the calling thread until tail no longer equals head, or timeout expires. Returns true
+   * if data became available. Always returns false immediately when called from an ISR. */
+  bool waitForData(const std::atomic<size_t>& tail, const size_t head,
+    const Duration& timeout) noexcept;
+  /** Called by the producer after publishing an element. Only enters the kernel if the consumer
+   * is actually blocked waiting for data. */
+  void notifyConsumer() noexcept
+  {
+    //Orders the tail_ publish before the consumer_ check, pairing with the fence in waitForData()
+    //so that either the consumer sees the new element or the producer sees the waiting consumer.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(consumer_.load(std::memory_order_relaxed) != nullptr)
+    {
+      wakeConsumer();
+    }
+  }
+private:
+  std::atomic<void*> consumer_;
+  void wakeConsumer() noexcept;
+};
+
+/** @class SpscQueue
+ *  @brief A lock-free, fixed capacity, single producer single consumer queue.
+ *
+ *  The SpscQueue is a ring buffer of capacity elements (which must be a power of two) held inline
+ *  in the object. Exactly one thread or ISR may push and exactly one thread or ISR may pop at any
+ *  given time; under that restriction no locking is required and push/pop are a handful of loads
+ *  and stores ordered with acquire/release atomics. This makes it well suited to ISR to thread
+ *  data paths, where a Queue would enter a kernel critical section and perform a full queue copy.
+ *
+ *  push() never blocks and is always ISR safe. pop() may block the consumer thread with a
+ *  timeout; the wait is implemented with a direct to task notification, so the producer only
+ *  enters the kernel when the consumer is actually asleep.
+ *
+ *  @note While blocked in pop(), the consumer thread's task notification value is used to signal
+ *  the wakeup and any pending notification is cleared. Threads that use task notifications for
+ *  other purposes should only pop() with a zero timeout.
+ *  */
+template<typename T, size_t capacity>
+class SpscQueue : private SpscQueue_Base
+{
+  static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0,
+    "SpscQueue capacity must be a power of two.");
+public:
+  SpscQueue() noexcept : head_{0}, tail_{0} {}
+  ~SpscQueue() noexcept
+  {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    for(size_t i = head_.load(std::memory_order_relaxed); i != tail; i++)
+    {
+      slot(i)->~T();
+    }
+  }
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+  /** Producer only. Copies item into the queue, returning Status::failure if it is full. */
+  Status push(const T& item) noexcept(std::is_nothrow_copy_constructible<T>::value)
+  {
+    return emplace(item);
+  }
+  /** Producer only. Moves item into the queue, returning Status::failure if it is full. */
+  Status push(T&& item) noexcept(std::is_nothrow_move_constructible<T>::value)
+  {
+    return emplace(std::move(item));
+  }
+  /** Producer only. Constructs an element in place at the back of the queue. */
+  template<typename... Args>
+  Status emplace(Args&&... args) noexcept(std::is_nothrow_constructible<T, Args...>::value)
+  {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if(tail - head_.load(std::memory_order_acquire) >= capacity)
+    {
+      return Status::failure;
+    }
+    new (slot(tail)) T(std::forward<Args>(args)...);
+    tail_.store(tail + 1, std::memory_order_release);
+    notifyConsumer();
+    return Status::success;
+  }
+  /** Consumer only. Moves the front element into item, waiting up to timeout for one to arrive.
+   * From an ISR the timeout is ignored and pop() never blocks. */
+  Status pop(T& item, const Duration& timeout = Duration::max())
+    noexcept(std::is_nothrow_move_assignable<T>::value)
+  {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if(head == tail_.load(std::memory_order_acquire))
+    {
+      if((timeout <= Duration::zero()) || (waitForData(tail_, head, timeout) == false))
+      {
+        return Status::failure;
+      }
+    }
+    T* front = slot(head);
+    item = std::move(*front);
+    front->~T();
+    head_.store(head + 1, std::memory_order_release);
+    return Status::success;
+  }
+  /** The number of elements currently in the queue. This is only a snapshot if called by a thread
+   * that is not the producer or consumer. */
+  size_t size() const noexcept
+  {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+  bool empty() const noexcept { return size() == 0; }
+  static constexpr size_t maxSize() noexcept { return capacity; }
+  /** Total RAM used by this SpscQueue. No heap is used. */
+  static constexpr size_t footprint_Bytes() noexcept { return sizeof(SpscQueue); }
+private:
+  alignas(T) uint8_t storage_[sizeof(T) * capacity];
+  /** Free running indices; head_ is only written by the consumer and tail_ by the producer. The
+   * unsigned wrap is harmless as capacity is a power of two. */
+  std::atomic<size_t> head_;
+  std::atomic<size_t> tail_;
+  T* slot(size_t index) noexcept
+  {
+    return reinterpret_cast<T*>(storage_) + (index & (capacity - 1));
+  }
+};
+
+/** @class MpmcQueue
+ *  @brief A bounded, multiple producer multiple consumer queue with a lock-free fast path.
+ *
+ *  The MpmcQueue is an array of capacity cells (which must be a power of two) held inline in the
+ *  object, each tagged with a sequence number as described by D. Vyukov's bounded MPMC queue.
+ *  Producers and consumers claim cells with a single compare-exchange on the enqueue or dequeue
+ *  position, so any number of threads and ISRs may push and pop concurrently without entering the
+ *  kernel. The RTOS is only involved when a thread has to sleep: a consumer waiting on an empty
+ *  queue or a producer waiting on a full queue blocks on a CountingSemaphore, which the opposite
+ *  side only signals while a waiter is registered.
+ *
+ *  The interface matches Queue<T> (push/pop/size with Duration timeouts), so call sites can be
+ *  switched between the two. Calls from an ISR never block, regardless of the timeout given.
+ *
+ *  @note Element construction must not throw, as a claimed cell cannot be handed back. Copy
+ *  pushes therefore require a nothrow copy constructor, and T must be nothrow movable.
+ *  @note A thread preempted between claiming and publishing a cell briefly hides that cell (and
+ *  any cells behind it) from consumers; they will report the queue as empty rather than wait.
+ *  */
+template<typename T, size_t capacity>
+class MpmcQueue
+{
+  static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0,
+    "MpmcQueue capacity must be a power of two.");
+  static_assert(std::is_nothrow_move_constructible<T>::value &&
+    std::is_nothrow_move_assignable<T>::value, "MpmcQueue elements must be nothrow movable.");
+public:
+  MpmcQueue() : enqueuePos_{0}, dequeuePos_{0}, waitingConsumers_{0}, waitingProducers_{0},
+    dataReady_{capacity, 0}, spaceReady_{capacity, 0}
+  {
+    for(size_t i = 0; i < capacity; i++)
+    {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  ~MpmcQueue() noexcept
+  {
+    const size_t tail = enqueuePos_.load(std::memory_order_relaxed);
+    for(size_t i = dequeuePos_.load(std::memory_order_relaxed); i != tail; i++)
+    {
+      cells_[i & (capacity - 1)].item()->~T();
+    }
+  }
+  MpmcQueue(const MpmcQueue&) = delete;
+  MpmcQueue& operator=(const MpmcQueue&) = delete;
+  /** Copies item into the queue, waiting up to timeout for space to become available. */
+  Status push(const T& item, const Duration& timeout = Duration::max()) noexcept
+  {
+    static_assert(std::is_nothrow_copy_constructible<T>::value,
+      "Copy pushes require a nothrow copy constructor.");
+    return waitFor([&]() { return tryEmplace(item); }, waitingProducers_, spaceReady_, timeout);
+  }
+  /** Moves item into the queue, waiting up to timeout for space to become available. */
+  Status push(T&& item, const Duration& timeout = Duration::max()) noexcept
+  {
+    return waitFor([&]() { return tryEmplace(std::move(item)); }, waitingProducers_, spaceReady_,
+      timeout);
+  }
+  /** Moves the front element into item, waiting up to timeout for one to arrive. */
+  Status pop(T& item, const Duration& timeout = Duration::max()) noexcept
+  {
+    return waitFor([&]() { return tryPop(item); }, waitingConsumers_, dataReady_, timeout);
+  }
+  /** The number of elements currently in the queue. With concurrent access this is a snapshot
+   * only, and includes cells that are claimed but not yet published. */
+  size_t size() const noexcept
+  {
+    const size_t head = dequeuePos_.load(std::memory_order_acquire);
+    const size_t tail = enqueuePos_.load(std::memory_order_acquire);
+    const size_t count = tail - head;
+    return count > capacity ? capacity : count;
+  }
+  bool empty() const noexcept { return size() == 0; }
+  static constexpr size_t maxSize() noexcept { return capacity; }
+  /** Total RAM used by this MpmcQueue, including its two semaphores. No heap is used. */
+  static constexpr size_t footprint_Bytes() noexcept { return sizeof(MpmcQueue); }
+private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    alignas(T) uint8_t storage[sizeof(T)];
+    T* item() noexcept { return reinterpret_cast<T*>(storage); }
+  };
+  Cell cells_[capacity];
+  std::atomic<size_t> enqueuePos_;
+  std::atomic<size_t> dequeuePos_;
+  std::atomic<uint32_t> waitingConsumers_;
+  std::atomic<uint32_t> waitingProducers_;
+  CountingSemaphore dataReady_;
+  CountingSemaphore spaceReady_;
+
+  /** Wakes a thread blocked on signal, if any are registered in waiters. */
+  static void signalWaiter(std::atomic<uint32_t>& waiters, Lock& signal) noexcept
+  {
+    //Orders the preceding cell publish before the waiter check, pairing with the registration in
+    //waitFor() so that either the waiter sees the change or it is signalled.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(waiters.load(std::memory_order_relaxed) > 0)
+    {
+      signal.unlock();
+    }
+  }
+  /** Attempts tryOp, blocking on signal between attempts until timeout expires. Spurious or stale
+   * signals simply result in another attempt. */
+  template<typename TryOp>
+  static Status waitFor(TryOp&& tryOp, std::atomic<uint32_t>& waiters, Lock& signal,
+    const Duration& timeout) noexcept
+  {
+    if(tryOp())
+    {
+      return Status::success;
+    }
+    if((timeout <= Duration::zero()) || System::inIsr())
+    {
+      return Status::failure;
+    }
+    const auto start = SteadyClock::now();
+    while(true)
+    {
+      waiters.fetch_add(1, std::memory_order_seq_cst);
+      if(tryOp())
+      {
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        return Status::success;
+      }
+      Duration remaining = timeout;
+      if(timeout != Duration::max())
+      {
+        remaining = timeout - (SteadyClock::now() - start);
+      }
+      Status woken = Status::failure;
+      if(remaining > Duration::zero())
+      {
+        woken = signal.lock(remaining);
+      }
+      waiters.fetch_sub(1, std::memory_order_relaxed);
+      if(woken != Status::success)
+      {
+        return tryOp() ? Status::success : Status::failure;
+      }
+    }
+  }
+  template<typename... Args>
+  bool tryEmplace(Args&&... args) noexcept
+  {
+    Cell* cell;
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    while(true)
+    {
+      cell = &cells_[pos & (capacity - 1)];
+      const size_t seq = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if(diff == 0)
+      {
+        if(enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if(diff < 0)
+      {
+        return false; //The queue is full.
+      }
+      else
+      {
+        pos = enqueuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    new (cell->storage) T(std::forward<Args>(args)...);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    signalWaiter(waitingConsumers_, dataReady_);
+    return true;
+  }
+  bool tryPop(T& item) noexcept
+  {
+    Cell* cell;
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    while(true)
+    {
+      cell = &cells_[pos & (capacity - 1)];
+      const size_t seq = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if(diff == 0)
+      {
+        if(dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if(diff < 0)
+      {
+        return false; //The queue is empty.
+      }
+      else
+      {
+        pos = dequeuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    item = std::move(*cell->item());
+    cell->item()->~T();
+    cell->sequence.store(pos + capacity, std::memory_order_release);
+    signalWaiter(waitingProducers_, spaceReady_);
+    return true;
+  }
+};
+
+/** @class PriorityQueue
+ *  @brief A fixed capacity, threadsafe queue that always pops its most urgent element first.
+ *
+ *  Each element is pushed with a key, and pop() returns the element whose key is most urgent
+ *  according to Compare; elements with equal keys are popped in FIFO order. By default keys are
+ *  uint32_t priorities where larger values are more urgent. A DeadlineQueue instead orders by
+ *  absolute Timestamp deadline, earliest first (EDF scheduling).
+ *
+ *  Storage is a binary heap held inline in the object, so push and pop are O(log capacity) and no
+ *  heap allocation is performed. The heap itself is guarded by a short CriticalSection, while
+ *  blocking is handled by a pair of CountingSemaphores tracking free and used slots. This gives
+ *  the same blocking push/pop semantics and Duration timeouts as Queue; push is ISR safe (it
+ *  never blocks from an ISR), as is a zero timeout pop.
+ *
+ *  Unlike a FIFO Queue, an urgent message never waits behind a backlog of less urgent ones.
+ *  @note Elements are moved within the heap inside a CriticalSection, so T should be small (e.g.
+ *  a pointer or handle) and must be nothrow movable.
+ *  */
+template<typename T, size_t capacity, typename Key = uint32_t, typename Compare = std::greater<Key>>
+class PriorityQueue
+{
+  static_assert(capacity > 0, "A PriorityQueue must hold at least one element.");
+  static_assert(std::is_nothrow_move_constructible<T>::value &&
+    std::is_nothrow_move_assignable<T>::value, "PriorityQueue elements must be nothrow movable.");
+public:
+  PriorityQueue() : count_{0}, sequence_{0}, used_{capacity, 0}, free_{capacity, capacity} {}
+  ~PriorityQueue() noexcept
+  {
+    for(size_t i = 0; i < count_; i++)
+    {
+      entry(i)->~Entry();
+    }
+  }
+  PriorityQueue(const PriorityQueue&) = delete;
+  PriorityQueue& operator=(const PriorityQueue&) = delete;
+  /** Inserts item with the given key, waiting up to timeout for space. */
+  Status push(T item, const Key& key, const Duration& timeout = Duration::max()) noexcept
+  {
+    if(free_.lock(timeout) != Status::success)
+    {
+      return Status::failure;
+    }
+    {
+      CriticalSection cs;
+      new (entry(count_)) Entry{key, sequence_++, std::move(item)};
+      siftUp(count_++);
+    }
+    used_.unlock();
+    return Status::success;
+  }
+  /** Removes the most urgent element, waiting up to timeout for one to arrive. */
+  Status pop(T& item, const Duration& timeout = Duration::max()) noexcept
+  {
+    Key key;
+    return pop(item, key, timeout);
+  }
+  /** As pop(item, timeout), also returning the key the element was pushed with. */
+  Status pop(T& item, Key& key, const Duration& timeout = Duration::max()) noexcept
+  {
+    if(used_.lock(timeout) != Status::success)
+    {
+      return Status::failure;
+    }
+    {
+      CriticalSection cs;
+      Entry* top = entry(0);
+      item = std::move(top->item);
+      key = top->key;
+      if(--count_ > 0)
+      {
+        *top = std::move(*entry(count_));
+        siftDown(0);
+      }
+      entry(count_)->~Entry();
+    }
+    free_.unlock();
+    return Status::success;
+  }
+  /** The number of elements currently in the queue. */
+  size_t size() const noexcept { return count_; }
+  bool empty() const noexcept { return size() == 0; }
+  static constexpr size_t maxSize() noexcept { return capacity; }
+  /** Total RAM used by this PriorityQueue, including its two semaphores. No heap is used. */
+  static constexpr size_t footprint_Bytes() noexcept { return sizeof(PriorityQueue); }
+private:
+  struct Entry
+  {
+    Key key;
+    /** Insertion order, used to keep equal keys FIFO. Wrapping is handled by signed comparison. */
+    uint32_t sequence;
+    T item;
+  };
+  alignas(Entry) uint8_t storage_[sizeof(Entry) * capacity];
+  volatile size_t count_;
+  uint32_t sequence_;
+  CountingSemaphore used_;
+  CountingSemaphore free_;
+  Entry* entry(size_t index) noexcept { return reinterpret_cast<Entry*>(storage_) + index; }
+  /** Returns true if a must be popped before b. */
+  static bool before(const Entry& a, const Entry& b) noexcept
+  {
+    if(Compare{}(a.key, b.key)) { return true; }
+    if(Compare{}(b.key, a.key)) { return false; }
+    return static_cast<int32_t>(a.sequence - b.sequence) < 0;
+  }
+  void siftUp(size_t index) noexcept
+  {
+    while(index > 0)
+    {
+      const size_t parent = (index - 1) / 2;
+      if(!before(*entry(index), *entry(parent)))
+      {
+        break;
+      }
+      std::swap(*entry(index), *entry(parent));
+      index = parent;
+    }
+  }
+  void siftDown(size_t index) noexcept
+  {
+    while(true)
+    {
+      const size_t left = 2 * index + 1;
+      const size_t right = left + 1;
+      size_t first = index;
+      if((left < count_) && before(*entry(left), *entry(first))) { first = left; }
+      if((right < count_) && before(*entry(right), *entry(first))) { first = right; }
+      if(first == index)
+      {
+        break;
+      }
+      std::swap(*entry(index), *entry(first));
+      index = first;
+    }
+  }
+};
+
+/** A PriorityQueue ordered by absolute deadline, earliest first. */
+template<typename T, size_t capacity>
+using DeadlineQueue = PriorityQueue<T, capacity, Timestamp, std::less<Timestamp>>;
+
 } /** namespace jel */
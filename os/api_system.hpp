@@ -33,14 +33,65 @@
 namespace jel
 {
 
+/** @class System
+ *  @brief CPU execution context queries.
+ *
+ *  These are called on every Queue, Lock and CriticalSection operation, so they are implemented
+ *  inline, selected by target at compile time, and compile to a single special register read:
+ *    -On Cortex-M targets the IPSR holds the active exception number, which is 0 in thread mode.
+ *    Every exception, including SysTick, PendSV and the faults, counts as an ISR.
+ *    -On Cortex-R targets the CPSR mode field is read. RTOS threads run in System mode.
+ *  */
 class System
 {
 public:
   /** Returns true if called from within a CPU exception state. This includes IRQ and FIQs, in
    * addition to various abort states on ARM. */
-  static bool cpuExceptionActive() noexcept;
+  static bool cpuExceptionActive() noexcept
+  {
+#if defined(HW_TARGET_RM57L843)
+    const uint32_t mode = cpsrMode();
+    return (mode != cpsrModeUser) && (mode != cpsrModeSystem);
+#else
+    return exceptionNumber() != 0;
+#endif
+  }
   /** Returns true if called from within an IRQ execution state. */
-  static bool inIsr() noexcept;
+  static bool inIsr() noexcept
+  {
+#if defined(HW_TARGET_RM57L843)
+    const uint32_t mode = cpsrMode();
+    return (mode == cpsrModeIrq) || (mode == cpsrModeFiq);
+#else
+    return exceptionNumber() != 0;
+#endif
+  }
+private:
+#if defined(HW_TARGET_RM57L843)
+  static constexpr uint32_t cpsrModeUser = 0x10;
+  static constexpr uint32_t cpsrModeFiq = 0x11;
+  static constexpr uint32_t cpsrModeIrq = 0x12;
+  static constexpr uint32_t cpsrModeSystem = 0x1F;
+  static uint32_t cpsrMode() noexcept
+  {
+    uint32_t cpsr;
+    __asm volatile("mrs %0, cpsr" : "=r"(cpsr));
+    return cpsr & 0x1F;
+  }
+#elif defined(HW_TARGET_TM4C123GH6PM) || defined(HW_TARGET_TM4C129XNCZAD) || \
+  defined(HW_TARGET_TM4C1294NCPDT) || defined(HW_TARGET_STM32F302RCT6)
+  static uint32_t exceptionNumber() noexcept
+  {
+    uint32_t ipsr;
+    __asm volatile("mrs %0, ipsr" : "=r"(ipsr));
+    return ipsr & 0x1FF;
+  }
+#else
+#ifndef __clang__
+#error "CPU architecture not supported."
+#endif
+  static uint32_t exceptionNumber() noexcept { return 0; }
+#endif
 };
 
 /** @class CriticalSection
@@ -84,6 +135,163 @@ public:
   SchedulerLock& operator=(SchedulerLock&&) = delete;
 };
 
+/** @class InterruptMaskMonitor
+ *  @brief Records the longest interval an InterruptMaskGuard site held interrupts masked.
+ *
+ *  A monitor is declared once per guarded site (usually as a static object) and passed to each
+ *  InterruptMaskGuard created there. Intervals are measured with the CPU cycle counter, which the
+ *  monitor constructor enables; the DWT CYCCNT on Cortex-M targets and the PMU cycle counter on
+ *  Cortex-R targets. A monitor should only be used by guards of a single execution context.
+ *  */
+class InterruptMaskMonitor
+{
+public:
+  explicit InterruptMaskMonitor(const char* name) noexcept;
+  InterruptMaskMonitor(const InterruptMaskMonitor&) = delete;
+  InterruptMaskMonitor& operator=(const InterruptMaskMonitor&) = delete;
+  const char* name() const noexcept { return name_; }
+  /** The longest masked interval recorded since construction or the last reset(), in CPU cycles. */
+  uint32_t longestInterval_cycles() const noexcept { return longest_; }
+  /** The number of masked intervals recorded since construction or the last reset(). */
+  uint32_t entries() const noexcept { return entries_; }
+  void reset() noexcept { longest_ = 0; entries_ = 0; }
+  void record(const uint32_t interval_cycles) noexcept
+  {
+    entries_++;
+    if(interval_cycles > longest_) { longest_ = interval_cycles; }
+  }
+  /** Returns the free running CPU cycle counter. It wraps, so only differences are meaningful. */
+  static uint32_t cycleCount() noexcept
+  {
+#if defined(HW_TARGET_RM57L843)
+    uint32_t cycles;
+    __asm volatile("mrc p15, 0, %0, c9, c13, 0" : "=r"(cycles));
+    return cycles;
+#elif defined(HW_TARGET_TM4C123GH6PM) || defined(HW_TARGET_TM4C129XNCZAD) || \
+  defined(HW_TARGET_TM4C1294NCPDT) || defined(HW_TARGET_STM32F302RCT6)
+    return *reinterpret_cast<volatile uint32_t*>(0xE0001004);
+#else
+    return 0;
+#endif
+  }
+private:
+  const char* name_;
+  uint32_t longest_;
+  uint32_t entries_;
+};
+
+/** @class InterruptMaskGuard
+ *  @brief An RAII object that masks only interrupts at or below a priority threshold while it
+ *  exists.
+ *
+ *  A CriticalSection masks every interrupt the RTOS is allowed to, which delays even the ISRs that
+ *  never touch the data being protected. An InterruptMaskGuard instead masks only the interrupts
+ *  whose priority is priorityThreshold or lower, so the higher priority ISRs keep running with no
+ *  added latency. It is intended for very short updates of data shared with a few low priority
+ *  ISRs. For example,
+ *  @code
+ *    //The UART ISR runs at priority 5, the motor control ISR at priority 2.
+ *    static InterruptMaskMonitor rxCountSite{"rxCount"};
+ *    {
+ *      InterruptMaskGuard<5> guard{&rxCountSite};
+ *      rxCount_ += n; //Safe from the UART ISR, the motor control ISR is not delayed.
+ *    }
+ *  @endcode
+ *
+ *  priorityThreshold is the interrupt priority level in the target's native ordering:
+ *    -On Cortex-M targets this is the NVIC priority level, not shifted into the implemented
+ *    priority bits, where 0 is the highest priority. BASEPRI is raised to the threshold; it is
+ *    never lowered, so guards nest correctly and may be used from ISRs.
+ *    -On the RM57 this is the VIM channel, where lower channels have a higher priority. All enabled
+ *    channels from priorityThreshold up are disabled in the VIM, and re-enabled on destruction.
+ *
+ *  Masking any RTOS interrupt also stops the scheduler tick and context switches, so no thread can
+ *  be preempted while a guard is held.
+ *  @note No RTOS functions may be called while a guard is held, and the holding thread must not
+ *  block. Leaving an RTOS critical section (including those inside SteadyClock::now()) resets the
+ *  interrupt mask on Cortex-M targets, silently ending the guard.
+ *  */
+template<uint32_t priorityThreshold>
+class InterruptMaskGuard
+{
+public:
+  explicit InterruptMaskGuard(InterruptMaskMonitor* monitor = nullptr) noexcept :
+    monitor_{monitor}
+  {
+    raise();
+    if(monitor_ != nullptr) { start_ = InterruptMaskMonitor::cycleCount(); }
+  }
+  ~InterruptMaskGuard() noexcept
+  {
+    if(monitor_ != nullptr) { monitor_->record(InterruptMaskMonitor::cycleCount() - start_); }
+    restore();
+  }
+  InterruptMaskGuard(const InterruptMaskGuard&) = delete;
+  InterruptMaskGuard(InterruptMaskGuard&&) = delete;
+  InterruptMaskGuard& operator=(const InterruptMaskGuard&) = delete;
+  InterruptMaskGuard& operator=(InterruptMaskGuard&&) = delete;
+private:
+  InterruptMaskMonitor* monitor_;
+  uint32_t start_;
+#if defined(HW_TARGET_RM57L843)
+  static_assert((priorityThreshold >= 2) && (priorityThreshold < 128),
+    "VIM channels 0 and 1 are hardwired and cannot be masked.");
+  static constexpr uint32_t firstWord = priorityThreshold / 32;
+  static constexpr uintptr_t vimReqEnaSet = 0xFFFFFE30;
+  static constexpr uintptr_t vimReqEnaClr = 0xFFFFFE40;
+  /** The channels this guard disabled. Channels that were already disabled are left alone. */
+  uint32_t disabled_[4];
+  void raise() noexcept
+  {
+    auto* set = reinterpret_cast<volatile uint32_t*>(vimReqEnaSet);
+    auto* clr = reinterpret_cast<volatile uint32_t*>(vimReqEnaClr);
+    for(uint32_t w = firstWord; w < 4; w++)
+    {
+      uint32_t mask = (w == firstWord) ? (0xFFFF'FFFF << (priorityThreshold % 32)) : 0xFFFF'FFFF;
+      disabled_[w] = set[w] & mask;
+      clr[w] = disabled_[w];
+    }
+    //Ensures no masked request is taken after the guard is constructed.
+    __asm volatile("dsb\n isb" ::: "memory");
+  }
+  void restore() noexcept
+  {
+    __asm volatile("dsb" ::: "memory");
+    auto* set = reinterpret_cast<volatile uint32_t*>(vimReqEnaSet);
+    for(uint32_t w = firstWord; w < 4; w++)
+    {
+      if(disabled_[w] != 0) { set[w] = disabled_[w]; }
+    }
+  }
+#elif defined(HW_TARGET_TM4C123GH6PM) || defined(HW_TARGET_TM4C129XNCZAD) || \
+  defined(HW_TARGET_TM4C1294NCPDT) || defined(HW_TARGET_STM32F302RCT6)
+#if defined(HW_TARGET_STM32F302RCT6)
+  static constexpr uint32_t priorityBits = 4;
+#else
+  static constexpr uint32_t priorityBits = 3;
+#endif
+  static_assert((priorityThreshold > 0) && (priorityThreshold < (1u << priorityBits)),
+    "Priority 0 cannot be masked by BASEPRI, use a CriticalSection instead.");
+  uint32_t basePri_;
+  void raise() noexcept
+  {
+    //BASEPRI_MAX only writes if the new value raises the mask, so nested guards never unmask.
+    __asm volatile("mrs %0, basepri\n msr basepri_max, %1\n isb" : "=&r"(basePri_) :
+      "r"(priorityThreshold << (8 - priorityBits)) : "memory");
+  }
+  void restore() noexcept
+  {
+    __asm volatile("msr basepri, %0" :: "r"(basePri_) : "memory");
+  }
+#else
+#ifndef __clang__
+#error "CPU architecture not supported."
+#endif
+  void raise() noexcept { }
+  void restore() noexcept { }
+#endif
+};
+
 }
 
 
@@ -87,7 +87,7 @@ public:
 class GenericThread_Base
 {
 protected:
-  using ThreadControlStructureMemory = uint8_t[1176];
+  using ThreadControlStructureMemory = uint8_t[1184];
   GenericThread_Base();
   void startThread(Thread* threadObject);
   static void dispatcher(void* threadInf);
@@ -217,7 +217,8 @@ public:
   static void schedulerExit(Handle handle);
   /** Used to indicate when a thread is created by the kernel. Not for application use. */
   static void schedulerThreadCreation(Handle handle);
-  /** Used to register the static idle task and associated information. Not for application use. */
+  /** Used to register a static kernel task (the idle and timer daemon tasks) and associated
+   * information. Not for application use. */
   static void schedulerAddIdleTask(Handle handle, ThreadInfo* info);
 #endif
   /** Returns the name of the thread from a given handle. */
@@ -228,6 +229,12 @@ protected:
   std::unique_ptr<ThreadInfo> inf_;
 #ifdef ENABLE_THREAD_STATISTICS
   static std::unique_ptr<InfoRegistry> ireg_;
+  /** Stores the ThreadInfo pointer in the RTOS thread local storage of the given thread. Passing a
+   * nullptr unbinds the thread, after which the scheduler hooks will ignore it. */
+  static void bindThreadInfo(Handle handle, ThreadInfo* info) noexcept;
+  /** Returns the ThreadInfo bound to a given thread in constant time, or a nullptr if no ThreadInfo
+   * has been bound yet. */
+  static ThreadInfo* boundThreadInfo(Handle handle) noexcept;
 #endif
 };
 
@@ -62,6 +62,8 @@ extern void jel_threadCreate(volatile void*);
 #define configCPU_CLOCK_HZ                          ((uint32_t)120000000)
 /** Heap size in bytes. The Tiva 129 jel implementation only uses a single heap. */
 #define configTOTAL_HEAP_SIZE                       ((size_t)(196606))
+/** Use the jel TLSF heap instead of the FreeRTOS heap_4 implementation for the system heap. */
+#define jelSYSTEM_HEAP_TLSF                         1
 /** Minimum task stack size, in 32b words. A value of  (1024 bytes) was found sufficient in
  * testing for most tasks, including the idle task. */
 #define configMINIMAL_STACK_SIZE                    ((unsigned short)128)
@@ -79,6 +81,7 @@ extern void jel_threadCreate(volatile void*);
 #elif defined(HW_TARGET_STM32F302RCT6)
 #define configCPU_CLOCK_HZ                          ((uint32_t)64000000)
 #define configTOTAL_HEAP_SIZE                       ((size_t)(32768))
+#define jelSYSTEM_HEAP_TLSF                         1
 #define configMINIMAL_STACK_SIZE                    ((unsigned short)128)
 #ifdef __NVIC_PRIO_BITS
 #define configPRIO_BITS         __NVIC_PRIO_BITS
@@ -98,6 +101,7 @@ extern void rtos_configCLEAR_TICK_INTERRUPT(void);
 
 #define configCPU_CLOCK_HZ                          ((uint32_t)110000000) //Use RTI timer clock
 #define configTOTAL_HEAP_SIZE                       ((size_t)(262143))
+#define jelSYSTEM_HEAP_TLSF                         1
 #define configMINIMAL_STACK_SIZE                    ((unsigned short)512)
 #define configUSE_FPU                               1
 #define configFPU_D32                               0
@@ -112,11 +116,28 @@ extern void rtos_configCLEAR_TICK_INTERRUPT(void);
 #error "No hardware target has been defined. JEL must be built for an explicit hardware target."
 #endif
 
+/** The system heap defaults to the FreeRTOS heap_4 implementation. When a target selects the TLSF
+ * heap, the heap_4 storage array is provided by the jel allocator and used as the TLSF pool, so
+ * the heap memory is not reserved twice. */
+#ifndef jelSYSTEM_HEAP_TLSF
+#define jelSYSTEM_HEAP_TLSF                         0
+#endif
+#if jelSYSTEM_HEAP_TLSF
+#define configAPPLICATION_ALLOCATED_HEAP            1
+#endif
+
 #ifdef ENABLE_THREAD_STATISTICS
 #define traceTASK_CREATE(x) jel_threadCreate(x)
 #define traceTASK_SWITCHED_IN() jel_threadEntry(pxCurrentTCB)
 #define traceTASK_SWITCHED_OUT() jel_threadExit(pxCurrentTCB)
+/** Each task stores a pointer to its jel ThreadInfo structure in a thread local storage slot. This
+ * allows the switch hooks to update thread statistics without searching the thread registry. */
+#define jelTHREAD_INFO_TLS_INDEX                    0
 #endif
+/** Each task records the priority inheritance applied to it by FastMutexes in a thread local
+ * storage slot, so that its base priority is restored only once it has released all of them. */
+#define jelFAST_MUTEX_TLS_INDEX                     1
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS     2
 
 #define configTICK_RATE_HZ                          ((portTickType)100)
 #define configMAX_TASK_NAME_LEN                     (24)
@@ -132,6 +153,7 @@ extern void rtos_configCLEAR_TICK_INTERRUPT(void);
 #define configUSE_RECURSIVE_MUTEXES                 1
 #define INCLUDE_xSemaphoreGetMutexHolder            1
 #define configUSE_COUNTING_SEMAPHORES               1
+#define configUSE_QUEUE_SETS                        1
 #define INCLUDE_xTaskGetCurrentTaskHandle           1
 //Avoid issues with generic clang tooling that doesn't use newlib.
 #ifndef __clang__
@@ -151,3 +173,11 @@ extern void rtos_configCLEAR_TICK_INTERRUPT(void);
 #define INCLUDE_vTaskDelayUntil                     1
 #define INCLUDE_vTaskDelay                          1
 #define INCLUDE_uxTaskGetStackHighWaterMark         1
+/** The timer daemon is required for deferred interrupt processing, i.e. setting EventGroup bits
+ * from an ISR. It runs at jel::Thread::Priority::maximum so deferred work is applied promptly. */
+#define configUSE_TIMERS                            1
+#define configTIMER_TASK_PRIORITY                   (8)
+#define configTIMER_QUEUE_LENGTH                    (16)
+#define configTIMER_TASK_STACK_DEPTH                configMINIMAL_STACK_SIZE
+#define INCLUDE_xTimerPendFunctionCall              1
+#define INCLUDE_xEventGroupSetBitFromISR            1
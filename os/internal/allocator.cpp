@@ -28,6 +28,10 @@
 
 /** C/C++ Standard Library Headers */
 #include <cstring>
+#include <vector>
+#include <list>
+#include <exception>
+#include <cxxabi.h>
 #include <cassert>
 #include <atomic>
 /** jel Library Headers */
@@ -35,6 +39,8 @@
 #include "os/api_exceptions.hpp"
 #include "os/api_system.hpp"
 #include "os/internal/indef.hpp"
+#include "os/internal/tlsf.hpp"
+#include "os/internal/slab.hpp"
 
 extern "C"
 {
@@ -48,12 +54,12 @@ void __wrap_vPortFree(void* ptr);
 
 void* __wrap_pvPortMalloc(size_t size)
 {
-  return jel::SystemAllocator::systemAllocator()->allocate(size);
+  return jel::SystemAllocator::systemAllocator()->allocate(size, __builtin_return_address(0));
 }
 
 void __wrap_vPortFree(void* ptr)
 {
-  jel::SystemAllocator::systemAllocator()->deallocate(ptr);
+  jel::SystemAllocator::systemAllocator()->deallocate(ptr, __builtin_return_address(0));
 }
 
 namespace jel
@@ -92,6 +98,8 @@ AllocatorStatisticsInterface::AllocatorStatisticsInterface(const char* allocator
   name_[maxNameLength_chars - 1] = '\0';
   totalAllocations_ = 0;
   totalDeallocations_ = 0;
+  totalInPlaceReallocations_ = 0;
+  totalMovedReallocations_ = 0;
 }
 
 AllocatorStatisticsInterface::~AllocatorStatisticsInterface() noexcept
@@ -124,11 +132,93 @@ AllocatorStatisticsInterface::~AllocatorStatisticsInterface() noexcept
  *
  * */
 static uint8_t systemAllocatorStorage[sizeof(SystemAllocator)] __attribute__((aligned(4)));
-std::atomic<bool> SystemAllocator::excpLocked_;
-uint8_t SystemAllocator::excpPage_[];
+std::atomic<size_t> SystemAllocator::excpHits_;
+std::atomic<size_t> SystemAllocator::excpFallbacks_;
+
+/** @brief Exception emergency pool storage.
+ *
+ * Each size class in config::exceptionPoolClasses occupies a contiguous run of blocks within
+ * exceptionPool, with a 32 bit in-use mask per class. Blocks are claimed with a compare and swap on
+ * the mask and released with an atomic AND, so exceptions can be thrown concurrently from any
+ * number of threads without a lock.
+ * */
+constexpr size_t exceptionClassCount =
+  sizeof(config::exceptionPoolClasses) / sizeof(config::exceptionPoolClasses[0]);
+constexpr size_t exceptionPoolAlignment_Bytes = 16;
+constexpr size_t exceptionPoolSize_Bytes()
+{
+  size_t total = 0;
+  for(const auto& c : config::exceptionPoolClasses) { total += c.blockSize_Bytes * c.totalBlocks; }
+  return total;
+}
+constexpr bool exceptionPoolClassesValid()
+{
+  for(const auto& c : config::exceptionPoolClasses)
+  {
+    if(c.totalBlocks == 0 || c.totalBlocks > 32) { return false; }
+    if((c.blockSize_Bytes % exceptionPoolAlignment_Bytes) != 0) { return false; }
+  }
+  return true;
+}
+static_assert(exceptionPoolClassesValid(),
+  "Exception pool classes must have 1-32 blocks each of a multiple of 16 bytes.");
+static uint8_t exceptionPool[exceptionPoolSize_Bytes()]
+  __attribute__((aligned(exceptionPoolAlignment_Bytes)));
+static std::atomic<uint32_t> exceptionSlotsInUse[exceptionClassCount];
 
 SystemAllocator* SystemAllocator::systemAllocator_ = nullptr;
 
+#if jelSYSTEM_HEAP_TLSF
+/** The heap_4 storage array is provided here (configAPPLICATION_ALLOCATED_HEAP) and managed by the
+ * TLSF heap instead. heap_4 is still linked but none of its allocation functions are called. */
+extern "C" uint8_t ucHeap[configTOTAL_HEAP_SIZE];
+uint8_t ucHeap[configTOTAL_HEAP_SIZE] __attribute__((aligned(8)));
+static uint8_t systemHeapStorage[sizeof(TlsfHeap)] __attribute__((aligned(4)));
+static TlsfHeap* systemHeap = nullptr;
+#endif
+static uint8_t systemSlabStorage[sizeof(SlabAllocator)] __attribute__((aligned(4)));
+static SlabAllocator* systemSlab = nullptr;
+
+/** Allocate from the backing system heap. The caller must hold a SchedulerLock. */
+static void* heapAllocate(size_t size) noexcept
+{
+#if jelSYSTEM_HEAP_TLSF
+  return systemHeap->allocate(size);
+#else
+  return __real_pvPortMalloc(size);
+#endif
+}
+
+/** Release memory to the backing system heap. The caller must hold a SchedulerLock. */
+static void heapDeallocate(void* ptr) noexcept
+{
+#if jelSYSTEM_HEAP_TLSF
+  systemHeap->deallocate(ptr);
+#else
+  __real_vPortFree(ptr);
+#endif
+}
+
+#if !jelSYSTEM_HEAP_TLSF
+/** Returns the usable size of a heap_4 block. heap_4 stores a BlockLink_t (a next pointer and the
+ * block size, with the top bit marking the block as allocated) immediately before the returned
+ * memory, padded to portBYTE_ALIGNMENT. The block size includes this header. */
+static size_t heap4UsableSize(const void* ptr) noexcept
+{
+  constexpr size_t alignMask = static_cast<size_t>(portBYTE_ALIGNMENT) - 1;
+  constexpr size_t headerSize = (2 * sizeof(size_t) + alignMask) & ~alignMask;
+  constexpr size_t allocatedBit = static_cast<size_t>(1) << ((sizeof(size_t) * 8) - 1);
+  const size_t* hdr =
+    reinterpret_cast<const size_t*>(static_cast<const uint8_t*>(ptr) - headerSize);
+  return (hdr[1] & ~allocatedBit) - headerSize;
+}
+#endif
+
+const SlabAllocator* systemSlabAllocator() noexcept
+{
+  return systemSlab;
+}
+
 SystemAllocator::SystemAllocator() : AllocatorStatisticsInterface("SYSTEM")
 {
   if(systemAllocator_ != nullptr)
@@ -136,6 +226,22 @@ SystemAllocator::SystemAllocator() : AllocatorStatisticsInterface("SYSTEM")
     throw Exception{ExceptionCode::allocatorConstructionFailed, 
       "The system allocator is already instantiated."};
   }
+#if jelSYSTEM_HEAP_TLSF
+  systemHeap = new (systemHeapStorage) TlsfHeap(ucHeap, sizeof(ucHeap));
+#endif
+  if(config::useSystemSlab)
+  {
+    //The slab pools are carved out of the system heap once and never returned.
+    constexpr size_t classCount =
+      sizeof(config::systemSlabClasses) / sizeof(config::systemSlabClasses[0]);
+    void* slabMem = heapAllocate(
+      SlabAllocator::storageRequired_Bytes(config::systemSlabClasses, classCount));
+    if(slabMem != nullptr)
+    {
+      systemSlab = new (systemSlabStorage) SlabAllocator(config::systemSlabClasses, classCount,
+        slabMem);
+    }
+  }
   systemAllocator_ = this;
 }
 
@@ -151,21 +257,142 @@ void SystemAllocator::constructSystemAllocator() noexcept
 
 void* SystemAllocator::allocate(size_t size)
 {
-  void* ptr = __real_pvPortMalloc(size);
+  return allocate(size, __builtin_return_address(0));
+}
+
+void SystemAllocator::deallocate(void* ptr)
+{
+  deallocate(ptr, __builtin_return_address(0));
+}
+
+void* SystemAllocator::reallocate(void* ptr, size_t size)
+{
+  return reallocate(ptr, size, __builtin_return_address(0));
+}
+
+void* SystemAllocator::allocate(size_t size, const void* callSite)
+{
+  void* ptr = nullptr;
+  {
+    SchedulerLock lock;
+    if(systemSlab != nullptr && size != 0)
+    {
+      ptr = systemSlab->allocate(size);
+    }
+    if(ptr == nullptr)
+    {
+      ptr = heapAllocate(size);
+    }
+  }
   if(ptr == nullptr)
   {
     throw std::bad_alloc();
   }
-  recordAllocation();
+  recordAllocation(ptr, size, callSite);
   return ptr;
 }
 
-void SystemAllocator::deallocate(void* ptr) 
+void SystemAllocator::deallocate(void* ptr, const void* callSite)
 {
-  __real_vPortFree(ptr);
-  recordDeallocation();
+#ifdef ENABLE_ALLOCATION_TRACING
+  const size_t size = (ptr != nullptr) ? usableSize(ptr) : 0;
+#else
+  const size_t size = 0;
+#endif
+  {
+    SchedulerLock lock;
+    if(systemSlab != nullptr && systemSlab->owns(ptr))
+    {
+      systemSlab->deallocate(ptr);
+    }
+    else
+    {
+      heapDeallocate(ptr);
+    }
+  }
+  recordDeallocation(ptr, size, callSite);
+}
+
+void* SystemAllocator::reallocate(void* ptr, size_t size, const void* callSite)
+{
+  if(ptr == nullptr)
+  {
+    return allocate(size, callSite);
+  }
+  if(size == 0)
+  {
+    deallocate(ptr, callSite);
+    return nullptr;
+  }
+  size_t oldSize;
+  {
+    SchedulerLock lock;
+    if(systemSlab != nullptr && systemSlab->owns(ptr))
+    {
+      oldSize = systemSlab->usableSize(ptr);
+      if(size <= oldSize)
+      {
+        recordReallocation(true);
+        return ptr;
+      }
+    }
+    else
+    {
+#if jelSYSTEM_HEAP_TLSF
+      if(systemHeap->resizeInPlace(ptr, size))
+      {
+        recordReallocation(true);
+        return ptr;
+      }
+      oldSize = TlsfHeap::usableSize(ptr);
+#else
+      oldSize = heap4UsableSize(ptr);
+      if(size <= oldSize)
+      {
+        recordReallocation(true);
+        return ptr;
+      }
+#endif
+    }
+  }
+  //The block has to move. Only the live bytes of the old block are copied.
+  void* newPtr = allocate(size, callSite);
+  std::memcpy(newPtr, ptr, oldSize < size ? oldSize : size);
+  deallocate(ptr, callSite);
+  recordReallocation(false);
+  return newPtr;
+}
+
+size_t SystemAllocator::usableSize(const void* ptr) const noexcept
+{
+  if(systemSlab != nullptr && systemSlab->owns(ptr))
+  {
+    return systemSlab->usableSize(ptr);
+  }
+#if jelSYSTEM_HEAP_TLSF
+  return TlsfHeap::usableSize(ptr);
+#else
+  return heap4UsableSize(ptr);
+#endif
 }
 
+#if jelSYSTEM_HEAP_TLSF
+size_t SystemAllocator::freeSpace_Bytes() const noexcept
+{
+  return systemHeap->freeSpace_Bytes();
+}
+
+size_t SystemAllocator::minimumFreeSpace_Bytes() const noexcept
+{
+  return systemHeap->minimumFreeSpace_Bytes();
+}
+
+size_t SystemAllocator::largestFreeBlock_Bytes() const noexcept
+{
+  SchedulerLock lock;
+  return systemHeap->largestFreeBlock_Bytes();
+}
+#else
 size_t SystemAllocator::freeSpace_Bytes() const noexcept
 {
   size_t fs = xPortGetFreeHeapSize();
@@ -178,40 +405,172 @@ size_t SystemAllocator::minimumFreeSpace_Bytes() const noexcept
   return mfs;
 }
 
+size_t SystemAllocator::largestFreeBlock_Bytes() const noexcept
+{
+  //heap_4 does not track its largest free block.
+  return freeSpace_Bytes();
+}
+#endif
+
 size_t SystemAllocator::totalSpace_Bytes() const noexcept
 {
   return configTOTAL_HEAP_SIZE;
 }
 
-void* SystemAllocator::allocateException(const size_t size) noexcept
+std::atomic<size_t> AllocationTrace::head_;
+std::atomic<size_t> AllocationTrace::sequence_[];
+AllocationTrace::Record AllocationTrace::ring_[];
+
+void AllocationTrace::record(const AllocatorStatisticsInterface* allocator, const void* ptr,
+  const size_t size, const void* callSite, const bool isAllocation) noexcept
+{
+  //Claim a slot, mark it as being written (sequence zero), fill it and then publish it with the
+  //sequence number of the claim. Readers discard any slot whose sequence changes while copying.
+  size_t claim = head_.fetch_add(1);
+  size_t slot = claim % depth;
+  sequence_[slot].store(0);
+  Record& r = ring_[slot];
+  r.timestamp = SteadyClock::now();
+  r.allocator = allocator;
+  r.callSite = callSite;
+  r.thread = xTaskGetCurrentTaskHandle();
+  r.ptr = ptr;
+  r.size_Bytes = size;
+  r.isAllocation = isAllocation;
+  sequence_[slot].store(claim + 1);
+}
+
+size_t AllocationTrace::snapshot(Record* records, size_t maxRecords) noexcept
 {
-  bool test = false; 
-  if(size > exceptionPageSize_bytes)
+  const size_t head = head_.load();
+  size_t n = head < depth ? head : depth;
+  if(n > maxRecords) { n = maxRecords; }
+  size_t copied = 0;
+  for(size_t claim = head - n; claim < head; claim++)
   {
-    return systemAllocator()->allocate(size);
+    const size_t slot = claim % depth;
+    if(sequence_[slot].load() != claim + 1) { continue; }
+    records[copied] = ring_[slot];
+    if(sequence_[slot].load() != claim + 1) { continue; }
+    copied++;
   }
-  if(excpLocked_.compare_exchange_strong(test, true))
+  return copied;
+}
+
+void AllocationTrace::clear() noexcept
+{
+  SchedulerLock lock;
+  for(auto& s : sequence_) { s.store(0); }
+  head_.store(0);
+}
+
+void* SystemAllocator::allocateException(const size_t size) noexcept
+{
+  //Take a free block from the smallest class that fits, moving to larger classes if it is full.
+  uint8_t* classBase = exceptionPool;
+  for(size_t c = 0; c < exceptionClassCount; c++)
   {
-    //Aquired and locked the page successfully.
-    return &excpPage_[0];
-  } 
-  else
+    const auto& cls = config::exceptionPoolClasses[c];
+    if(size <= cls.blockSize_Bytes)
+    {
+      const uint32_t classMask = (cls.totalBlocks == 32) ? ~0u : ((1u << cls.totalBlocks) - 1);
+      uint32_t inUse = exceptionSlotsInUse[c].load();
+      while((~inUse & classMask) != 0)
+      {
+        const uint32_t slot = __builtin_ctz(~inUse & classMask);
+        if(exceptionSlotsInUse[c].compare_exchange_weak(inUse, inUse | (1u << slot)))
+        {
+          excpHits_++;
+          return classBase + (slot * cls.blockSize_Bytes);
+        }
+        //inUse was reloaded by the failed exchange; retry with the updated mask.
+      }
+    }
+    classBase += cls.blockSize_Bytes * cls.totalBlocks;
+  }
+  excpFallbacks_++;
+  try
   {
-    //Failed to lock the page/page is already in use.
     return systemAllocator()->allocate(size);
   }
+  catch(const std::bad_alloc&)
+  {
+    return nullptr;
+  }
 }
 
 void SystemAllocator::deallocateException(void* except) noexcept
 {
-  if(except == &excpPage_[0])
+  uint8_t* ptr = static_cast<uint8_t*>(except);
+  if(ptr < exceptionPool || ptr >= (exceptionPool + sizeof(exceptionPool)))
+  {
+    systemAllocator()->deallocate(except);
+    return;
+  }
+  uint8_t* classBase = exceptionPool;
+  for(size_t c = 0; c < exceptionClassCount; c++)
+  {
+    const auto& cls = config::exceptionPoolClasses[c];
+    uint8_t* classEnd = classBase + cls.blockSize_Bytes * cls.totalBlocks;
+    if(ptr < classEnd)
+    {
+      const uint32_t slot = (ptr - classBase) / cls.blockSize_Bytes;
+      exceptionSlotsInUse[c].fetch_and(~(1u << slot));
+      return;
+    }
+    classBase = classEnd;
+  }
+}
+
+MonotonicAllocator::MonotonicAllocator(void* buffer, const size_t size_Bytes, const char* name)
+  noexcept : AllocatorStatisticsInterface(name), AllocatorInterface(),
+  buffer_{static_cast<uint8_t*>(buffer)}, size_{size_Bytes}, offset_{0}, lastOffset_{0},
+  highWater_{0}
+{
+  //Skip any leading bytes needed to align the start of the buffer.
+  size_t misalignment = reinterpret_cast<uintptr_t>(buffer_) % alignment_Bytes;
+  if(misalignment != 0)
   {
-    excpLocked_.store(false);
+    offset_ = alignment_Bytes - misalignment;
+    if(offset_ > size_) { offset_ = size_; }
+    lastOffset_ = highWater_ = offset_;
   }
-  else
+}
+
+void* MonotonicAllocator::allocate(size_t size)
+{
+  if(size == 0) { return nullptr; }
+  size = (size + alignment_Bytes - 1) & ~(alignment_Bytes - 1);
+  if(size > (size_ - offset_))
   {
-    systemAllocator()->deallocate(except);
+    throw std::bad_alloc();
   }
+  lastOffset_ = offset_;
+  offset_ += size;
+  if(offset_ > highWater_) { highWater_ = offset_; }
+  recordAllocation(&buffer_[lastOffset_], size, __builtin_return_address(0));
+  return &buffer_[lastOffset_];
+}
+
+void MonotonicAllocator::deallocate(void* ptr)
+{
+  if(ptr == nullptr) { return; }
+  assert((ptr >= buffer_) && (ptr < (buffer_ + size_)));
+  //Releasing the most recent allocation is a trivial roll back; anything else waits for a rewind.
+  if(ptr == &buffer_[lastOffset_] && lastOffset_ < offset_)
+  {
+    offset_ = lastOffset_;
+  }
+  recordDeallocation(ptr, 0, __builtin_return_address(0));
+}
+
+void MonotonicAllocator::rewind(const size_t offset) noexcept
+{
+  if(offset < offset_)
+  {
+    offset_ = offset;
+  }
+  lastOffset_ = offset_;
 }
 
 #ifdef TARGET_SUPPORTS_CPPUTEST
@@ -228,7 +587,8 @@ TEST(JEL_TestGroup_Allocators, SystemAllocator)
 {
   size_t start_allocs = SystemAllocator::systemAllocator()->totalAllocations();
   size_t start_deallocs = SystemAllocator::systemAllocator()->totalDeallocations();
-  size_t alloc_size_bytes = 32;
+  //Large enough to bypass the slab front-end, so the heap free space changes.
+  size_t alloc_size_bytes = 256;
   size_t before_free = SystemAllocator::systemAllocator()->freeSpace_Bytes();
   int* arr = static_cast<int*>(SystemAllocator::systemAllocator()->allocate(alloc_size_bytes));
   CHECK(arr);
@@ -240,20 +600,347 @@ TEST(JEL_TestGroup_Allocators, SystemAllocator)
   CHECK(start_allocs < SystemAllocator::systemAllocator()->totalAllocations());
   CHECK(start_deallocs < SystemAllocator::systemAllocator()->totalDeallocations());
 }
+
+TEST(JEL_TestGroup_Allocators, SystemReallocate)
+{
+  SystemAllocator* sa = SystemAllocator::systemAllocator();
+  size_t inPlace = sa->totalInPlaceReallocations();
+  size_t moved = sa->totalMovedReallocations();
+  uint8_t* p = static_cast<uint8_t*>(sa->reallocate(nullptr, 300));
+  CHECK(p);
+  for(size_t i = 0; i < 300; i++) { p[i] = static_cast<uint8_t>(i); }
+  //Shrinking never moves the block.
+  CHECK(sa->reallocate(p, 200) == p);
+  CHECK(sa->totalInPlaceReallocations() == inPlace + 1);
+  CHECK(sa->usableSize(p) >= 200);
+  //Block the space after p, so growing it must move and copy the live bytes.
+  void* blocker = sa->allocate(256);
+  uint8_t* q = static_cast<uint8_t*>(sa->reallocate(p, 4096));
+  CHECK(q);
+  for(size_t i = 0; i < 200; i++) { CHECK(q[i] == static_cast<uint8_t>(i)); }
+  CHECK(sa->totalInPlaceReallocations() + sa->totalMovedReallocations() == inPlace + moved + 2);
+  CHECK(sa->reallocate(q, 0) == nullptr);
+  sa->deallocate(blocker);
+}
+
+TEST(JEL_TestGroup_Allocators, StdAllocatorAdapters)
+{
+  auto pool = std::make_unique<BlockAllocator<32, 64>>("StdAdapt");
+  {
+    std::vector<uint32_t, StdAllocator<uint32_t>> v{StdAllocator<uint32_t>{*pool}};
+    for(uint32_t i = 0; i < 100; i++) { v.push_back(i); }
+    CHECK(v[99] == 99);
+    CHECK(pool->totalAllocations() > 0);
+    CHECK(pool->freeSpace_Bytes() < pool->totalSpace_Bytes());
+    //Node based containers rebind the allocator to their node type.
+    std::list<uint16_t, StdAllocator<uint16_t>> l{StdAllocator<uint16_t>{*pool}};
+    l.push_back(1); l.push_back(2);
+    CHECK(l.size() == 2);
+    CHECK(StdAllocator<uint32_t>{*pool} == StdAllocator<uint16_t>{*pool});
+    CHECK(StdAllocator<uint32_t>{*pool} != StdAllocator<uint32_t>{});
+  }
+  CHECK(pool->freeSpace_Bytes() == pool->totalSpace_Bytes());
+#if __has_include(<memory_resource>)
+  {
+    MemoryResource res{*pool};
+    std::pmr::vector<uint32_t> pv{&res};
+    for(uint32_t i = 0; i < 20; i++) { pv.push_back(i); }
+    CHECK(pv[19] == 19);
+    CHECK(pool->freeSpace_Bytes() < pool->totalSpace_Bytes());
+  }
+  CHECK(pool->freeSpace_Bytes() == pool->totalSpace_Bytes());
+#endif
+}
+
+TEST(JEL_TestGroup_Allocators, ExceptionPool)
+{
+  constexpr size_t iterations = 200;
+  const size_t hits = SystemAllocator::exceptionPoolHits();
+  const size_t fallbacks = SystemAllocator::exceptionPoolFallbacks();
+  Duration worst = Duration::zero();
+  Duration total = Duration::zero();
+  for(size_t i = 0; i < iterations; i++)
+  {
+    Timestamp start = SteadyClock::now();
+    try
+    {
+      throw static_cast<uint32_t>(i);
+    }
+    catch(const uint32_t& v)
+    {
+      //A nested throw requires a second pool block while the first is still live.
+      try { throw v + 1; } catch(const uint32_t&) { }
+    }
+    Duration d = SteadyClock::now() - start;
+    total += d;
+    if(d > worst) { worst = d; }
+  }
+  UT_PRINT(StringFromFormat("Throw/catch (nested) x%u: worst %lldus, mean %lldus.", iterations,
+    worst.toMicroseconds(), total.toMicroseconds() / static_cast<int64_t>(iterations))
+    .asCharString());
+  CHECK(SystemAllocator::exceptionPoolHits() >= hits + 2 * iterations);
+  //No heap allocations are needed to throw while pool blocks are available.
+  CHECK(SystemAllocator::exceptionPoolFallbacks() == fallbacks);
+  //std::exception_ptr and rethrow_exception use dependent exceptions, also served by the pool.
+  std::exception_ptr ep;
+  try { throw 7; } catch(...) { ep = std::current_exception(); }
+  bool caught = false;
+  try { std::rethrow_exception(ep); } catch(const int& v) { caught = (v == 7); }
+  CHECK(caught);
+}
+
+TEST(JEL_TestGroup_Allocators, ArenaRewind)
+{
+  auto arena = std::make_unique<Arena<256>>("ArenaTst");
+  CHECK(arena->freeSpace_Bytes() == 256);
+  void* a = arena->allocate(10);
+  CHECK(a);
+  CHECK((reinterpret_cast<uintptr_t>(a) % MonotonicAllocator::alignment_Bytes) == 0);
+  {
+    auto scope = arena->mark();
+    void* b = arena->allocate(100);
+    void* c = arena->allocate(50);
+    CHECK(b && c && (b != c));
+    CHECK(arena->freeSpace_Bytes() == 256 - 16 - 104 - 56);
+    //Only the most recent allocation is released by a deallocate.
+    arena->deallocate(b);
+    CHECK(arena->freeSpace_Bytes() == 256 - 16 - 104 - 56);
+    arena->deallocate(c);
+    CHECK(arena->freeSpace_Bytes() == 256 - 16 - 104);
+    bool threw = false;
+    try { arena->allocate(256); } catch(const std::bad_alloc&) { threw = true; }
+    CHECK(threw);
+  }
+  //The marker released everything allocated in its scope.
+  CHECK(arena->freeSpace_Bytes() == 256 - 16);
+  CHECK(arena->minimumFreeSpace_Bytes() == 256 - 16 - 104 - 56);
+  arena->reset();
+  CHECK(arena->freeSpace_Bytes() == 256);
+  CHECK(arena->allocate(8) == a);
+}
+
+#ifdef ENABLE_ALLOCATION_TRACING
+TEST(JEL_TestGroup_Allocators, AllocationTrace)
+{
+  auto pool = std::make_unique<BlockAllocator<16, 16>>("TraceTst");
+  AllocationTrace::clear();
+  void* p = pool->allocate(8);
+  pool->deallocate(p);
+  AllocationTrace::Record recs[AllocationTrace::depth];
+  size_t n = AllocationTrace::snapshot(recs, AllocationTrace::depth);
+  //Other threads may allocate concurrently, so search for the two records made here.
+  bool foundAlloc = false, foundDealloc = false;
+  for(size_t i = 0; i < n; i++)
+  {
+    if(recs[i].allocator != pool.get() || recs[i].ptr != p) { continue; }
+    if(recs[i].isAllocation) { foundAlloc = (recs[i].size_Bytes == 8); }
+    else { foundDealloc = foundAlloc; }
+    CHECK(recs[i].callSite != nullptr);
+  }
+  CHECK(foundAlloc && foundDealloc);
+  //The ring buffer keeps only the most recent depth records.
+  for(size_t i = 0; i < AllocationTrace::depth; i++) { pool->deallocate(pool->allocate(1)); }
+  CHECK(AllocationTrace::snapshot(recs, AllocationTrace::depth) <= AllocationTrace::depth);
+  CHECK(AllocationTrace::totalRecords() >= 2 * AllocationTrace::depth + 2);
+}
+#endif
+
+TEST_GROUP(JEL_TestGroup_BlockAllocator)
+{
+  static constexpr size_t blockSize_Bytes = 16;
+  static constexpr size_t totalBlocks = 512;
+  static constexpr size_t benchmarkIterations = 200;
+  using TestPool = BlockAllocator<blockSize_Bytes, totalBlocks>;
+  std::unique_ptr<TestPool> pool;
+  /** Reproduces the original block-at-a-time first fit search so the bitmap search can be compared
+   * against it. The in-use flags are mirrored from the pool under test. */
+  struct LinearScanReference
+  {
+    bool inUse[totalBlocks];
+    size_t findRun(const size_t blksreq) const
+    {
+      size_t contBlocks = 0;
+      for(size_t i = 0; i < totalBlocks; i++)
+      {
+        if(!inUse[i])
+        {
+          if(++contBlocks == blksreq) { return (i + 1) - contBlocks; }
+        }
+        else
+        {
+          contBlocks = 0;
+        }
+      }
+      return SIZE_MAX;
+    }
+  };
+  void setup()
+  {
+    pool = std::make_unique<TestPool>("BlkTest");
+  }
+  void teardown()
+  {
+    pool.reset();
+  }
+  /** Size in bytes that occupies exactly the given number of blocks. */
+  static size_t bytesForBlocks(const size_t blocks)
+  {
+    return blocks * blockSize_Bytes - sizeof(size_t);
+  }
+};
+TEST(JEL_TestGroup_BlockAllocator, AllocateAndFree)
+{
+  void* a = pool->allocate(bytesForBlocks(1));
+  void* b = pool->allocate(bytesForBlocks(3));
+  void* c = pool->allocate(bytesForBlocks(40));
+  CHECK(a && b && c);
+  CHECK(pool->freeSpace_Bytes() == (totalBlocks - 44) * blockSize_Bytes);
+  CHECK(pool->minimumFreeSpace_Bytes() == pool->freeSpace_Bytes());
+  pool->deallocate(b);
+  //A first fit allocation of the same size must reuse the hole left by b.
+  void* d = pool->allocate(bytesForBlocks(2));
+  CHECK(d == b);
+  pool->deallocate(a);
+  pool->deallocate(c);
+  pool->deallocate(d);
+  CHECK(pool->freeSpace_Bytes() == totalBlocks * blockSize_Bytes);
+  CHECK(pool->totalAllocations() == 4);
+  CHECK(pool->totalDeallocations() == 4);
+}
+TEST(JEL_TestGroup_BlockAllocator, Exhaustion)
+{
+  void* ptrs[totalBlocks];
+  for(size_t i = 0; i < totalBlocks; i++)
+  {
+    ptrs[i] = pool->allocate(bytesForBlocks(1));
+    CHECK(ptrs[i]);
+  }
+  CHECK(pool->freeSpace_Bytes() == 0);
+  bool threw = false;
+  try { pool->allocate(1); } catch(const std::bad_alloc&) { threw = true; }
+  CHECK(threw);
+  //Free every other block; no run of two blocks exists even though half the pool is free.
+  for(size_t i = 0; i < totalBlocks; i += 2)
+  {
+    pool->deallocate(ptrs[i]);
+  }
+  threw = false;
+  try { pool->allocate(bytesForBlocks(2)); } catch(const std::bad_alloc&) { threw = true; }
+  CHECK(threw);
+  for(size_t i = 1; i < totalBlocks; i += 2)
+  {
+    pool->deallocate(ptrs[i]);
+  }
+  void* all = pool->allocate(bytesForBlocks(totalBlocks - 1));
+  CHECK(all);
+  pool->deallocate(all);
+}
+TEST(JEL_TestGroup_BlockAllocator, LatencyAgainstLinearScan)
+{
+  //The pool is filled to each level with single block allocations, leaving holes of a single
+  //block throughout, which is the worst case for a first fit search of a multi block run.
+  constexpr size_t fillLevels_Percent[] = { 0, 50, 90 };
+  constexpr size_t runLengths[] = { 1, 4 };
+  void* ptrs[totalBlocks];
+  LinearScanReference ref;
+  for(const size_t fill : fillLevels_Percent)
+  {
+    const size_t fillBlocks = (totalBlocks * fill) / 100;
+    for(size_t i = 0; i < totalBlocks; i++) { ref.inUse[i] = false; }
+    for(size_t i = 0; i < fillBlocks; i++)
+    {
+      ptrs[i] = pool->allocate(bytesForBlocks(1));
+      ref.inUse[i] = true;
+    }
+    for(size_t i = 0; i < fillBlocks; i += 8)
+    {
+      pool->deallocate(ptrs[i]);
+      ref.inUse[i] = false;
+    }
+    for(const size_t run : runLengths)
+    {
+      Timestamp start = SteadyClock::now();
+      for(size_t i = 0; i < benchmarkIterations; i++)
+      {
+        pool->deallocate(pool->allocate(bytesForBlocks(run)));
+      }
+      Duration bitmapTime = SteadyClock::now() - start;
+      volatile size_t sink = 0;
+      start = SteadyClock::now();
+      for(size_t i = 0; i < benchmarkIterations; i++)
+      {
+        sink += ref.findRun(run);
+      }
+      Duration linearTime = SteadyClock::now() - start;
+      (void)sink;
+      UT_PRINT(StringFromFormat("%u%% full, %u block(s): bitmap allocate+deallocate %lldus, "
+        "linear scan (search only) %lldus per %u allocations.", fill, run,
+        bitmapTime.toMicroseconds(), linearTime.toMicroseconds(),
+        benchmarkIterations).asCharString());
+      //The bitmap timing includes the full allocate/deallocate path while the reference only
+      //searches, so the two are only compared where the search dominates. A single block request
+      //is satisfied by the first hole, which the linear scan finds after a single compare.
+      if((run > 1) && (fill >= 50))
+      {
+        CHECK(bitmapTime <= linearTime);
+      }
+    }
+    for(size_t i = 0; i < fillBlocks; i++)
+    {
+      if((i % 8) != 0) { pool->deallocate(ptrs[i]); }
+    }
+    CHECK(pool->freeSpace_Bytes() == totalBlocks * blockSize_Bytes);
+  }
+}
 #endif
 } /** namespace jel */
 
-/**
- *  TEMPORARILY DISABLED
- *
-extern "C" void *
-__cxa_allocate_exception(std::size_t thrown_size) throw()
+/** Overrides of the C++ runtime exception allocation functions, replacing the libsupc++
+ * implementations (and their heap first, emergency pool second scheme) with the jel exception pool.
+ * The runtime expects a zeroed __cxa_refcounted_exception header immediately before the thrown
+ * object. That structure is private to libsupc++, so a fixed reserve is used that is at least as
+ * large as the header (128 bytes on both ARM EABI and x86-64) and keeps the thrown object 16 byte
+ * aligned. Dependent exceptions (used by std::rethrow_exception) are smaller than this reserve. */
+namespace
 {
-  return jel::SystemAllocator::allocateException(thrown_size);
+constexpr size_t exceptionHeaderReserve_Bytes = 128;
 }
 
-extern "C" void __cxa_free_exception(void *thrown_exception)
+namespace __cxxabiv1
+{
+
+extern "C" void* __cxa_allocate_exception(std::size_t thrown_size) noexcept
 {
-  jel::SystemAllocator::deallocateException(thrown_exception);
+  uint8_t* mem = static_cast<uint8_t*>(
+    jel::SystemAllocator::allocateException(thrown_size + exceptionHeaderReserve_Bytes));
+  if(mem == nullptr)
+  {
+    std::terminate();
+  }
+  std::memset(mem, 0, exceptionHeaderReserve_Bytes);
+  return mem + exceptionHeaderReserve_Bytes;
+}
+
+extern "C" void __cxa_free_exception(void* thrown_exception) noexcept
+{
+  jel::SystemAllocator::deallocateException(
+    static_cast<uint8_t*>(thrown_exception) - exceptionHeaderReserve_Bytes);
+}
+
+extern "C" __cxa_dependent_exception* __cxa_allocate_dependent_exception() noexcept
+{
+  void* mem = jel::SystemAllocator::allocateException(exceptionHeaderReserve_Bytes);
+  if(mem == nullptr)
+  {
+    std::terminate();
+  }
+  std::memset(mem, 0, exceptionHeaderReserve_Bytes);
+  return static_cast<__cxa_dependent_exception*>(mem);
 }
-*/
+
+extern "C" void __cxa_free_dependent_exception(__cxa_dependent_exception* dependent) noexcept
+{
+  jel::SystemAllocator::deallocateException(dependent);
+}
+
+} /** namespace __cxxabiv1 */
@@ -0,0 +1,221 @@
+/** @file os/internal/buffers.cpp
+ *  @brief Implementation of the stream and message buffer primitives
+ *
+ *  @detail
+ *
+ *  @author Jonathan Thomson 
+ */
+/**
+ * MIT License
+ * 
+ * Copyright 2018, Jonathan Thomson 
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** C/C++ Standard Library Headers */
+#include <cassert>
+#include <cstring>
+
+/** jel Library Headers */
+#include "os/api_buffers.hpp"
+#include "os/api_allocator.hpp"
+#include "os/api_exceptions.hpp"
+#include "os/api_system.hpp"
+#include "os/api_threads.hpp"
+#include "os/internal/indef.hpp"
+/** RTOS Library Headers */
+#include "stream_buffer.h"
+#include "message_buffer.h"
+
+namespace jel
+{
+
+ByteBuffer_Base::ByteBuffer_Base(const size_t capacity_Bytes, const size_t triggerLevel_Bytes,
+  uint8_t* storage, const bool isMessageBuffer)
+{
+  static_assert(sizeof(CbStorage) == sizeof(StaticStreamBuffer_t),
+    "Static buffer storage size must be equal to underlying OS primitive size.");
+  auto cb = reinterpret_cast<StaticStreamBuffer_t*>(cbMemory_);
+  //Unlike the dynamic create functions, the static ones do not add the byte the RTOS keeps free
+  //to distinguish full from empty, so the whole storage is passed as the buffer size.
+  if(isMessageBuffer)
+  {
+    handle_ = xMessageBufferCreateStatic(MessageBuffer::storage_Bytes(capacity_Bytes), storage,
+      cb);
+  }
+  else
+  {
+    handle_ = xStreamBufferCreateStatic(StreamBuffer::storage_Bytes(capacity_Bytes),
+      triggerLevel_Bytes, storage, cb);
+  }
+  if(handle_ == nullptr)
+  {
+    throw Exception{ExceptionCode::queueConstructionFailed,
+      "Failed while constructing stream/message buffer."};
+  }
+}
+
+ByteBuffer_Base::~ByteBuffer_Base() noexcept
+{
+  if(handle_ != nullptr)
+  {
+    vStreamBufferDelete(handle_);
+  }
+}
+
+size_t ByteBuffer_Base::genericSend(const void* data, const size_t length_Bytes,
+  const Duration& timeout) noexcept
+{
+  assert(data || (length_Bytes == 0));
+  if(System::inIsr())
+  {
+    auto wakeHpTask = pdFALSE;
+    size_t sent = xStreamBufferSendFromISR(handle_, data, length_Bytes, &wakeHpTask);
+    portYIELD_FROM_ISR(wakeHpTask);
+    return sent;
+  }
+  else
+  {
+    return xStreamBufferSend(handle_, data, length_Bytes, toTicks(timeout));
+  }
+}
+
+size_t ByteBuffer_Base::genericReceive(void* buffer, const size_t bufferLength_Bytes,
+  const Duration& timeout) noexcept
+{
+  assert(buffer || (bufferLength_Bytes == 0));
+  if(System::inIsr())
+  {
+    auto wakeHpTask = pdFALSE;
+    size_t received = xStreamBufferReceiveFromISR(handle_, buffer, bufferLength_Bytes,
+      &wakeHpTask);
+    portYIELD_FROM_ISR(wakeHpTask);
+    return received;
+  }
+  else
+  {
+    return xStreamBufferReceive(handle_, buffer, bufferLength_Bytes, toTicks(timeout));
+  }
+}
+
+size_t ByteBuffer_Base::genericBytesAvailable() const noexcept
+{
+  return xStreamBufferBytesAvailable(handle_);
+}
+
+size_t ByteBuffer_Base::genericFreeSpace() const noexcept
+{
+  return xStreamBufferSpacesAvailable(handle_);
+}
+
+Status ByteBuffer_Base::genericReset() noexcept
+{
+  return xStreamBufferReset(handle_) == pdPASS ? Status::success : Status::failure;
+}
+
+Status ByteBuffer_Base::genericSetTriggerLevel(const size_t triggerLevel_Bytes) noexcept
+{
+  return xStreamBufferSetTriggerLevel(handle_, triggerLevel_Bytes) == pdTRUE ? Status::success :
+    Status::failure;
+}
+
+#ifdef TARGET_SUPPORTS_CPPUTEST
+TEST_GROUP(JEL_TestGroup_Buffers)
+{
+  static constexpr size_t TriggerLevel_Bytes = 8;
+  static void bytewiseProducer(void* args)
+  {
+    auto* sb = static_cast<StreamBuffer*>(args);
+    for(uint8_t i = 0; i < TriggerLevel_Bytes; i++)
+    {
+      ThisThread::sleepfor(Duration::milliseconds(1));
+      sb->send(&i, 1, Duration::zero());
+    }
+    while(true)
+    {
+      ThisThread::sleepfor(Duration::seconds(1));
+    }
+  }
+  void setup()
+  {
+  }
+  void teardown()
+  {
+  }
+};
+TEST(JEL_TestGroup_Buffers, StreamSendReceive)
+{
+  StaticStreamBuffer<16> sb;
+  const char text[] = "0123456789ABCDEFGHIJ";
+  char out[32] = {};
+  CHECK(sb.send(text, 10, Duration::zero()) == 10);
+  //Only the free space is written once the buffer fills.
+  CHECK(sb.send(text + 10, 10, Duration::zero()) == 6);
+  CHECK(sb.size() == 16);
+  CHECK(sb.freeSpace() == 0);
+  CHECK(sb.receive(out, 4, Duration::zero()) == 4);
+  CHECK(sb.receive(out + 4, sizeof(out) - 4, Duration::zero()) == 12);
+  CHECK(std::memcmp(out, text, 16) == 0);
+  CHECK(sb.receive(out, sizeof(out), Duration::milliseconds(2)) == 0);
+}
+TEST(JEL_TestGroup_Buffers, StaticBuffersUseNoHeap)
+{
+  auto* alloc = SystemAllocator::systemAllocator();
+  SchedulerLock lock;
+  const size_t allocs = alloc->totalAllocations();
+  {
+    StaticStreamBuffer<32> sb;
+    StaticMessageBuffer<32> mb;
+    CHECK(sb.send("abc", 3, Duration::zero()) == 3);
+    CHECK(mb.send("abc", 3, Duration::zero()) == Status::success);
+  }
+  CHECK(alloc->totalAllocations() == allocs);
+}
+TEST(JEL_TestGroup_Buffers, MessageBoundariesArePreserved)
+{
+  MessageBuffer mb{64};
+  char out[16] = {};
+  CHECK(mb.send("first", 5, Duration::zero()) == Status::success);
+  CHECK(mb.send("second!", 7, Duration::zero()) == Status::success);
+  CHECK(mb.size() == 5 + 7 + 2 * MessageBuffer::messageHeader_Bytes);
+  //A buffer too small for the next message leaves it in place.
+  CHECK(mb.receive(out, 4, Duration::zero()) == 0);
+  CHECK(mb.receive(out, sizeof(out), Duration::zero()) == 5);
+  CHECK(std::memcmp(out, "first", 5) == 0);
+  CHECK(mb.receive(out, sizeof(out), Duration::zero()) == 7);
+  CHECK(std::memcmp(out, "second!", 7) == 0);
+  CHECK(mb.empty());
+  //Messages are never partially written.
+  char big[64] = {};
+  CHECK(mb.send(big, sizeof(big), Duration::zero()) != Status::success);
+}
+TEST(JEL_TestGroup_Buffers, TriggerLevelBatchesWakeups)
+{
+  StaticStreamBuffer<32, TriggerLevel_Bytes> sb;
+  uint8_t out[32];
+  Thread producer{&bytewiseProducer, &sb, "sbProd", 256, Thread::Priority::high};
+  //The reader is only woken once the whole trigger level has arrived, not once per byte.
+  CHECK(sb.receive(out, sizeof(out), Duration::milliseconds(500)) == TriggerLevel_Bytes);
+  for(uint8_t i = 0; i < TriggerLevel_Bytes; i++)
+  {
+    CHECK(out[i] == i);
+  }
+  CHECK(sb.setTriggerLevel(64) != Status::success);
+}
+#endif
+
+} /** namespace jel */
@@ -39,8 +39,11 @@ namespace jel
 namespace cli 
 {
 
+/** Per-command allocations (the parsed argument list and any CommandIo::scratch() memory) are made
+ * from an arena that is rewound after each command completes. */
+constexpr size_t cliScratchSpace_Bytes = 256;
 using CliArgumentPool = 
-  BlockAllocator<sizeof(Argument) + 16, config::cliMaximumArguments>;
+  Arena<((sizeof(Argument) + 16) * config::cliMaximumArguments) + cliScratchSpace_Bytes>;
 
 std::unique_ptr<CliArgumentPool> argumentPool;
 
@@ -1157,6 +1160,9 @@ int CliInstance::executeCommand(Tokenizer& tokens)
   //If we have the command matched, we need to construct a CommandIo object, including an argument
   //container, and execute the command if the IO object is valid.
   assert(acptr_); 
+  //Everything the command allocates from the argument arena is released when this scope exits,
+  //after the CommandIo (and argument list) has been destroyed.
+  MonotonicAllocator::Marker argumentScope = argumentPool->mark();
   CommandIo cmdIo(this, tokens, *acptr_, *vtt_);
   if(!cmdIo.isValid_)
   {
@@ -1205,6 +1211,11 @@ CommandIo::~CommandIo() noexcept
   vtt_.printer().editConfig().automaticNewline = preIoPpConfig_.automaticNewline;
 }
 
+AllocatorInterface& CommandIo::scratch() noexcept
+{
+  return *argumentPool;
+}
+
 AsyncLock CommandIo::lockOuput(const Duration& timeout)
 {
   return vtt_.lockOutput(timeout);
@@ -32,10 +32,14 @@
 /** C/C++ Standard Library Headers */
 #include <cassert>
 #include <cstring>
+#include <algorithm>
 /** jel Library Headers */
 #include "os/internal/indef.hpp"
+#include "os/internal/slab.hpp"
 #include "os/api_cli.hpp"
 #include "os/api_allocator.hpp"
+#include "os/api_locks.hpp"
+#include "os/api_queues.hpp"
 #include "os/api_threads.hpp"
 #include "hw/api_exceptions.hpp"
 #include "hw/api_wdt.hpp"
@@ -54,6 +58,9 @@ int32_t cliCmdReadclock(cli::CommandIo& io);
 int32_t cliCmdReboot(cli::CommandIo& io);
 int32_t cliCmdRmon(cli::CommandIo& io);
 int32_t cliCmdEnableTestLib(cli::CommandIo& io);
+int32_t cliCmdMemtrace(cli::CommandIo& io);
+int32_t cliCmdQueues(cli::CommandIo& io);
+int32_t cliCmdLocks(cli::CommandIo& io);
 
 const cli::CommandEntry cliCommandArray[] =
 {
@@ -110,6 +117,35 @@ const cli::CommandEntry cliCommandArray[] =
     "CPU load.\n",
     cli::AccessPermission::unrestricted, nullptr
   },
+  {
+    "memtrace", cliCmdMemtrace, "%?s",
+    "Displays the allocation trace, a record of the most recent allocator calls. This requires a "
+    "build with ENABLE_ALLOCATION_TRACING defined. By default the records are aggregated by call "
+    "site (the address of the code requesting memory, which can be resolved with addr2line), "
+    "sorted by number of calls. One parameter is optionally accepted:\n"
+    "\t[0] String: '-r' prints the raw records, oldest first. '-c' clears the trace.\n",
+    cli::AccessPermission::unrestricted, nullptr
+  },
+  {
+    "queues", cliCmdQueues, "%?s",
+    "Lists every Queue with its depth, maximum depth, push/pop counts, failed (timed out) pushes "
+    "and pops, and a histogram of how long operations were blocked waiting for space or data. "
+    "This requires a build with ENABLE_QUEUE_STATISTICS defined. Queues that are often full or "
+    "that have long push waits are the source of backpressure. One parameter is optionally "
+    "accepted:\n"
+    "\t[0] String: '-c' clears the statistics of all queues.\n",
+    cli::AccessPermission::unrestricted, nullptr
+  },
+  {
+    "locks", cliCmdLocks, "%?s",
+    "Lists every Lock ranked by contention: the number of lock() calls that found it unavailable, "
+    "then the total time spent waiting for it. Also shown are the acquisitions, timeouts, longest "
+    "wait and, for mutexes, the longest hold time and the handle of the last owner (as listed by "
+    "'cpuuse'). This requires a build with ENABLE_LOCK_STATISTICS defined. One parameter is "
+    "optionally accepted:\n"
+    "\t[0] String: '-c' clears the statistics of all locks.\n",
+    cli::AccessPermission::unrestricted, nullptr
+  },
   {
     "etl", cliCmdEnableTestLib, "",
     "Enables the os module testing CLI command library.\n",
@@ -184,10 +220,27 @@ int32_t cliCmdMemuse(cli::CommandIo& io)
       "Allocator %s:\r\n\tFree Space: %uB\r\n\tMin. Free Space: %uB\r\n\tTotal Size: %uB\r\n",
       sptr->name(), sptr->freeSpace_Bytes(), sptr->minimumFreeSpace_Bytes(), 
       sptr->totalSpace_Bytes());
+    io.print("\tLargest Free Block: %uB\r\n\tFragmentation: %u%%\r\n",
+      sptr->largestFreeBlock_Bytes(), sptr->fragmentation_Percent());
     io.print("\tAllocations: %u\r\n\tDeallocations: %u\r\n",
       sptr->totalAllocations(), sptr->totalDeallocations());
+    io.print("\tReallocations (In Place): %u\r\n\tReallocations (Moved): %u\r\n",
+      sptr->totalInPlaceReallocations(), sptr->totalMovedReallocations());
     aeptr = aeptr->next;
   }
+  const SlabAllocator* slab = systemSlabAllocator();
+  if(slab != nullptr)
+  {
+    for(size_t i = 0; i < slab->classCount(); i++)
+    {
+      const auto& cs = slab->classStatistics(i);
+      io.print("System slab class %uB:\r\n\tIn Use: %u/%u\r\n\tHigh Water: %u\r\n"
+        "\tHits: %u\r\n\tMisses: %u\r\n", cs.blockSize_Bytes, cs.inUse, cs.totalBlocks,
+        cs.highWater, cs.hits, cs.misses);
+    }
+  }
+  io.print("Exception pool:\r\n\tHits: %u\r\n\tHeap Fallbacks: %u\r\n",
+    SystemAllocator::exceptionPoolHits(), SystemAllocator::exceptionPoolFallbacks());
   io.print(
     "jel String pool use:\r\n\tFree items: %u\r\n\tMin. Free Items: %u\r\n\tTotal Items: %u\r\n", 
     jelStringPool->itemsInPool(), jelStringPool->minimumItemsInPool(), 
@@ -310,7 +363,8 @@ size_t printMemUse(cli::CommandIo& io, char* pBuf, const size_t pBufLen)
   size_t lc = 0;
   io.fmt.isBold = true;
   io.constPrint(
-    " Heap           | Free (B)   | Min. Free (B) | Size (B)   | Allocs.  | Deallocs.\r\n");
+    " Heap           | Free (B)   | Min. Free (B) | Largest (B) | Frag. | Size (B)   | Allocs.  |"
+    " Deallocs. | Reallocs. (In Place/Moved)\r\n");
   io.fmt.isBold = false;
   lc++;
   const auto *alloc = AllocatorStatisticsInterface::systemAllocator();
@@ -322,16 +376,50 @@ size_t printMemUse(cli::CommandIo& io, char* pBuf, const size_t pBufLen)
     io.print(" %-11s|", pBuf);
     std::snprintf(pBuf, pBufLen, "%u", stats->minimumFreeSpace_Bytes());
     io.print(" %-14s|", pBuf);
+    std::snprintf(pBuf, pBufLen, "%u", stats->largestFreeBlock_Bytes());
+    io.print(" %-12s|", pBuf);
+    std::snprintf(pBuf, pBufLen, "%u%%", stats->fragmentation_Percent());
+    io.print(" %-6s|", pBuf);
     std::snprintf(pBuf, pBufLen, "%u", stats->totalSpace_Bytes());
     io.print(" %-11s|", pBuf);
     std::snprintf(pBuf, pBufLen, "%u", stats->totalAllocations());
     io.print(" %-9s|", pBuf);
     std::snprintf(pBuf, pBufLen, "%u", stats->totalDeallocations());
+    io.print(" %-10s|", pBuf);
+    std::snprintf(pBuf, pBufLen, "%u/%u", stats->totalInPlaceReallocations(),
+      stats->totalMovedReallocations());
     io.print(" %-9s", pBuf);
     io.print("\r\n");
     lc++;
     alloc = alloc->next;
   }
+  const SlabAllocator* slab = systemSlabAllocator();
+  if(slab != nullptr)
+  {
+    io.fmt.isBold = true;
+    io.constPrint(
+      " Slab Class (B) | In Use     | High Water    | Blocks     | Hits     | Misses\r\n");
+    io.fmt.isBold = false;
+    lc++;
+    for(size_t i = 0; i < slab->classCount(); i++)
+    {
+      const auto& cs = slab->classStatistics(i);
+      std::snprintf(pBuf, pBufLen, "%u", cs.blockSize_Bytes);
+      io.print(" %-15s|", pBuf);
+      std::snprintf(pBuf, pBufLen, "%u", cs.inUse);
+      io.print(" %-11s|", pBuf);
+      std::snprintf(pBuf, pBufLen, "%u", cs.highWater);
+      io.print(" %-14s|", pBuf);
+      std::snprintf(pBuf, pBufLen, "%u", cs.totalBlocks);
+      io.print(" %-11s|", pBuf);
+      std::snprintf(pBuf, pBufLen, "%u", cs.hits);
+      io.print(" %-9s|", pBuf);
+      std::snprintf(pBuf, pBufLen, "%u", cs.misses);
+      io.print(" %-9s", pBuf);
+      io.print("\r\n");
+      lc++;
+    }
+  }
   return lc;
 }
 
@@ -550,6 +638,192 @@ int32_t cliCmdRmon(cli::CommandIo& io)
 
 extern const cli::Library cliCmdLib_tests;
 
+int32_t cliCmdMemtrace(cli::CommandIo& io)
+{
+#ifndef ENABLE_ALLOCATION_TRACING
+  io.print("Allocation tracing is not enabled on this build.");
+#else
+  bool raw = false;
+  if(io.args.totalArguments() > 0)
+  {
+    if(io.args[0].asString() == "-c")
+    {
+      AllocationTrace::clear();
+      io.print("Allocation trace cleared.");
+      return 0;
+    }
+    else if(io.args[0].asString() == "-r")
+    {
+      raw = true;
+    }
+    else
+    {
+      io.print("'%s' is not a supported argument.", io.args[0].asString().c_str());
+      return -1;
+    }
+  }
+  //The snapshot buffer is allocated before the snapshot is taken, so its own allocation is the
+  //newest record.
+  auto recs = std::make_unique<AllocationTrace::Record[]>(AllocationTrace::depth);
+  const size_t total = AllocationTrace::totalRecords();
+  const size_t n = AllocationTrace::snapshot(recs.get(), AllocationTrace::depth);
+  io.fmt.automaticNewline = false;
+  io.print("%u records (of %u since last clear):\r\n", n, total);
+  if(raw)
+  {
+    io.fmt.isBold = true;
+    io.constPrint(
+      " Time (us)    | Op    | Size (B) | Call Site  | Thread     | Ptr        | Heap\r\n");
+    io.fmt.isBold = false;
+    for(size_t i = 0; i < n; i++)
+    {
+      const auto& r = recs[i];
+      //Records outlive their allocators, so the allocator is only dereferenced if it is still
+      //registered in the allocator table. The scheduler lock keeps it registered while its name is
+      //copied.
+      char heap[AllocatorStatisticsInterface::maxNameLength_chars] = "(destroyed)";
+      {
+        SchedulerLock schLock;
+        for(auto* ae = AllocatorStatisticsInterface::systemAllocator(); ae != nullptr;
+          ae = ae->next)
+        {
+          if(ae->statsIf != r.allocator) { continue; }
+          std::strncpy(heap, r.allocator->name(), sizeof(heap) - 1);
+          heap[sizeof(heap) - 1] = '\0';
+          break;
+        }
+      }
+      io.print(" %-13lld| %-6s| %-9u| %-11p| %-11p| %-11p| %s\r\n",
+        r.timestamp.toDuration().toMicroseconds(), r.isAllocation ? "alloc" : "free",
+        r.size_Bytes, r.callSite, r.thread, r.ptr, heap);
+    }
+    return 0;
+  }
+  //Aggregate allocations by call site. Deallocations are excluded as their call site is rarely of
+  //interest; it is the allocating code that needs to be removed from a real-time path.
+  struct CallSite
+  {
+    const void* address;
+    size_t count;
+    size_t bytes;
+  };
+  constexpr size_t maxSites = 32;
+  CallSite sites[maxSites];
+  size_t siteCount = 0;
+  size_t untracked = 0;
+  for(size_t i = 0; i < n; i++)
+  {
+    if(!recs[i].isAllocation) { continue; }
+    size_t s = 0;
+    while(s < siteCount && sites[s].address != recs[i].callSite) { s++; }
+    if(s == siteCount)
+    {
+      if(siteCount == maxSites) { untracked++; continue; }
+      sites[siteCount++] = CallSite{recs[i].callSite, 0, 0};
+    }
+    sites[s].count++;
+    sites[s].bytes += recs[i].size_Bytes;
+  }
+  std::sort(&sites[0], &sites[siteCount],
+    [](const CallSite& a, const CallSite& b) { return a.count > b.count; });
+  io.fmt.isBold = true;
+  io.constPrint(" Call Site  | Allocs. | Bytes\r\n");
+  io.fmt.isBold = false;
+  for(size_t i = 0; i < siteCount; i++)
+  {
+    io.print(" %-11p| %-8u| %u\r\n", sites[i].address, sites[i].count, sites[i].bytes);
+  }
+  if(untracked > 0)
+  {
+    io.print("%u allocations from further call sites were not aggregated.\r\n", untracked);
+  }
+#endif
+  return 0;
+}
+
+int32_t cliCmdQueues(cli::CommandIo& io)
+{
+#ifndef ENABLE_QUEUE_STATISTICS
+  io.print("Queue statistics are not enabled on this build.");
+#else
+  if(io.args.totalArguments() > 0)
+  {
+    if(io.args[0].asString() == "-c")
+    {
+      QueueStatistics::resetAll();
+      io.print("Queue statistics cleared.");
+      return 0;
+    }
+    io.print("'%s' is not a supported argument.", io.args[0].asString().c_str());
+    return -1;
+  }
+  //Allocate the snapshot buffer before counting, with some headroom for queues created meanwhile.
+  const size_t maxQueues = QueueStatistics::registeredQueues() + 4;
+  auto snaps = std::make_unique<QueueStatistics::Snapshot[]>(maxQueues);
+  const size_t n = QueueStatistics::snapshot(snaps.get(), maxQueues);
+  io.fmt.automaticNewline = false;
+  io.print("%u queues:\r\n", n);
+  io.fmt.isBold = true;
+  io.constPrint(" Queue            | Depth     | Max   | Pushes     | Pops       | Fails (P/C) | "
+    "Waits <100us/<1ms/<10ms/<100ms/<1s/>=1s\r\n");
+  io.fmt.isBold = false;
+  for(size_t i = 0; i < n; i++)
+  {
+    const auto& q = snaps[i];
+    if(q.name[0] != '\0') { io.print(" %-17s", q.name); } else { io.print(" %-17p", q.queue); }
+    io.print("| %4u/%-5u| %-6u| %-11u| %-11u| %5u/%-6u| %u/%u/%u/%u/%u/%u\r\n",
+      q.depth, q.capacity, q.maxDepth, q.pushes, q.pops, q.pushFailures, q.popFailures,
+      q.waits[0], q.waits[1], q.waits[2], q.waits[3], q.waits[4], q.waits[5]);
+  }
+#endif
+  return 0;
+}
+
+int32_t cliCmdLocks(cli::CommandIo& io)
+{
+#ifndef ENABLE_LOCK_STATISTICS
+  io.print("Lock statistics are not enabled on this build.");
+#else
+  if(io.args.totalArguments() > 0)
+  {
+    if(io.args[0].asString() == "-c")
+    {
+      LockStatistics::resetAll();
+      io.print("Lock statistics cleared.");
+      return 0;
+    }
+    io.print("'%s' is not a supported argument.", io.args[0].asString().c_str());
+    return -1;
+  }
+  //Allocate the snapshot buffer before counting, with some headroom for locks created meanwhile.
+  const size_t maxLocks = LockStatistics::registeredLocks() + 4;
+  auto snaps = std::make_unique<LockStatistics::Snapshot[]>(maxLocks);
+  const size_t n = LockStatistics::snapshot(snaps.get(), maxLocks);
+  std::sort(&snaps[0], &snaps[n],
+    [](const LockStatistics::Snapshot& a, const LockStatistics::Snapshot& b)
+    {
+      if(a.contended != b.contended) { return a.contended > b.contended; }
+      return a.totalWait_us > b.totalWait_us;
+    });
+  io.fmt.automaticNewline = false;
+  io.print("%u locks:\r\n", n);
+  io.fmt.isBold = true;
+  io.constPrint(" Lock             | Type   | Acquired   | Contended  | Timeouts | "
+    "Wait total/max (us)  | Max hold (us) | Last owner\r\n");
+  io.fmt.isBold = false;
+  for(size_t i = 0; i < n; i++)
+  {
+    const auto& l = snaps[i];
+    if(l.name[0] != '\0') { io.print(" %-17s", l.name); } else { io.print(" %-17p", l.lock); }
+    io.print("| %-7s| %-11u| %-11u| %-9u| %10llu/%-10u| ", l.kind, l.acquisitions, l.contended,
+      l.timeouts, l.totalWait_us, l.maxWait_us);
+    if(l.lastOwner != nullptr) { io.print("%-14u| %p\r\n", l.maxHold_us, l.lastOwner); }
+    else { io.print("%-14s| -\r\n", "-"); }
+  }
+#endif
+  return 0;
+}
+
 int32_t cliCmdEnableTestLib(cli::CommandIo& io)
 {
 #ifndef NDEBUG 
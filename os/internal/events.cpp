@@ -0,0 +1,220 @@
+/** @file os/internal/events.cpp
+ *  @brief Implementation of the event group primitive
+ *
+ *  @detail
+ *
+ *  @author Jonathan Thomson
+ */
+/**
+ * MIT License
+ *
+ * Copyright 2018, Jonathan Thomson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** C/C++ Standard Library Headers */
+#include <cassert>
+
+/** jel Library Headers */
+#include "os/api_events.hpp"
+#include "os/api_exceptions.hpp"
+#include "os/api_locks.hpp"
+#include "os/api_system.hpp"
+#include "os/api_threads.hpp"
+#include "os/internal/indef.hpp"
+/** RTOS Library Headers */
+#include "event_groups.h"
+
+namespace jel
+{
+
+EventGroup::EventGroup()
+{
+  static_assert(sizeof(CbStorage) == sizeof(StaticEventGroup_t),
+    "Static event group storage size must be equal to underlying OS primitive size.");
+  handle_ = xEventGroupCreateStatic(reinterpret_cast<StaticEventGroup_t*>(cbMemory_));
+  if(handle_ == nullptr)
+  {
+    throw Exception{ExceptionCode::lockConstructionFailed,
+      "Failed while constructing event group."};
+  }
+}
+
+EventGroup::~EventGroup() noexcept
+{
+  if(handle_ != nullptr)
+  {
+    vEventGroupDelete(handle_);
+  }
+}
+
+Status EventGroup::set(const Bits bits) noexcept
+{
+  assert((bits & ~usableBits) == 0);
+  if(System::inIsr())
+  {
+    auto wakeHpTask = pdFALSE;
+    if(xEventGroupSetBitsFromISR(handle_, bits, &wakeHpTask) == pdPASS)
+    {
+      //Switches to the timer daemon on exit, if it is now the highest priority ready thread.
+      portYIELD_FROM_ISR(wakeHpTask);
+      return Status::success;
+    }
+    return Status::failure;
+  }
+  xEventGroupSetBits(handle_, bits);
+  return Status::success;
+}
+
+Status EventGroup::clear(const Bits bits) noexcept
+{
+  assert((bits & ~usableBits) == 0);
+  if(System::inIsr())
+  {
+    return xEventGroupClearBitsFromISR(handle_, bits) == pdPASS ? Status::success :
+      Status::failure;
+  }
+  xEventGroupClearBits(handle_, bits);
+  return Status::success;
+}
+
+EventGroup::Bits EventGroup::get() const noexcept
+{
+  if(System::inIsr())
+  {
+    return xEventGroupGetBitsFromISR(handle_);
+  }
+  return xEventGroupGetBits(handle_);
+}
+
+EventGroup::Bits EventGroup::wait(const Bits bits, const bool waitForAll, const Duration& timeout,
+  const bool clearOnExit) noexcept
+{
+  assert((bits != 0) && ((bits & ~usableBits) == 0));
+  if(System::inIsr())
+  {
+    assert(false); //Illegal to wait on an event group in an ISR.
+    return 0;
+  }
+  //On a timeout the RTOS returns the current bits, so only those that were waited on are returned.
+  return xEventGroupWaitBits(handle_, bits, clearOnExit ? pdTRUE : pdFALSE,
+    waitForAll ? pdTRUE : pdFALSE, toTicks(timeout)) & bits;
+}
+
+EventGroup::Bits EventGroup::waitAny(const Bits bits, const Duration& timeout,
+  const bool clearOnExit) noexcept
+{
+  return wait(bits, false, timeout, clearOnExit);
+}
+
+EventGroup::Bits EventGroup::waitAll(const Bits bits, const Duration& timeout,
+  const bool clearOnExit) noexcept
+{
+  return wait(bits, true, timeout, clearOnExit);
+}
+
+Status EventGroup::sync(const Bits setBits, const Bits waitBits, const Duration& timeout) noexcept
+{
+  assert(((setBits | waitBits) & ~usableBits) == 0);
+  if(System::inIsr())
+  {
+    assert(false); //Illegal to wait on an event group in an ISR.
+    return Status::failure;
+  }
+  if((xEventGroupSync(handle_, setBits, waitBits, toTicks(timeout)) & waitBits) == waitBits)
+  {
+    return Status::success;
+  }
+  return Status::failure;
+}
+
+#ifdef TARGET_SUPPORTS_CPPUTEST
+TEST_GROUP(JEL_TestGroup_EventGroup)
+{
+  static constexpr EventGroup::Bits mainBit = 0x1;
+  static constexpr EventGroup::Bits workerBit = 0x2;
+  struct WorkerArgs
+  {
+    EventGroup* events;
+    std::atomic<bool> synced;
+  };
+  static void setterThread(void* args)
+  {
+    auto* events = static_cast<EventGroup*>(args);
+    ThisThread::sleepfor(Duration::milliseconds(5));
+    events->set(workerBit);
+    while(true)
+    {
+      ThisThread::sleepfor(Duration::seconds(1));
+    }
+  }
+  static void syncThread(void* args)
+  {
+    auto* wa = static_cast<WorkerArgs*>(args);
+    wa->synced = (wa->events->sync(workerBit, mainBit | workerBit, Duration::milliseconds(500))
+      == Status::success);
+    while(true)
+    {
+      ThisThread::sleepfor(Duration::seconds(1));
+    }
+  }
+  void setup()
+  {
+  }
+  void teardown()
+  {
+  }
+};
+TEST(JEL_TestGroup_EventGroup, SetClearAndWait)
+{
+  EventGroup events;
+  CHECK(events.get() == 0);
+  CHECK(events.waitAny(mainBit | workerBit, Duration::zero()) == 0);
+  CHECK(events.set(mainBit) == Status::success);
+  //waitAll() fails while only some of the bits are set, and does not clear them.
+  CHECK(events.waitAll(mainBit | workerBit, Duration::milliseconds(2)) == mainBit);
+  CHECK(events.get() == mainBit);
+  CHECK(events.waitAny(mainBit | workerBit, Duration::zero(), false) == mainBit);
+  CHECK(events.get() == mainBit);
+  CHECK(events.waitAny(mainBit | workerBit, Duration::zero()) == mainBit);
+  CHECK(events.get() == 0);
+  events.set(mainBit | workerBit);
+  CHECK(events.clear(workerBit) == Status::success);
+  CHECK(events.get() == mainBit);
+}
+TEST(JEL_TestGroup_EventGroup, WaitWakesOnSetFromThread)
+{
+  EventGroup events;
+  Thread setter{&setterThread, &events, "evSetter", 256, Thread::Priority::high};
+  CHECK(events.waitAny(workerBit, Duration::milliseconds(500)) == workerBit);
+  CHECK(events.get() == 0);
+}
+TEST(JEL_TestGroup_EventGroup, SyncRendezvous)
+{
+  EventGroup events;
+  WorkerArgs args{&events, {false}};
+  Thread worker{&syncThread, &args, "evSync", 256, Thread::Priority::high};
+  ThisThread::sleepfor(Duration::milliseconds(5));
+  CHECK(events.sync(mainBit, mainBit | workerBit, Duration::milliseconds(500)) == Status::success);
+  ThisThread::sleepfor(Duration::milliseconds(5));
+  CHECK(args.synced);
+  //The rendezvous bits are cleared once all participants have arrived.
+  CHECK(events.get() == 0);
+}
+#endif
+
+} /** namespace jel */
@@ -41,6 +41,8 @@ void vApplicationIdleHook(void);
 void vApplicationTickHook(void);
 void vApplicationGetIdleTaskMemory(StaticTask_t **tcbSpace, StackType_t **stackSpace, 
   uint32_t *stackSize);
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcbSpace, StackType_t **stackSpace, 
+  uint32_t *stackSize);
 void jel_threadCreate(volatile void* handle);
 void jel_threadEntry(volatile void* handle);
 void jel_threadExit(volatile void* handle);
@@ -104,6 +106,34 @@ void vApplicationGetIdleTaskMemory(StaticTask_t **tcbSpace, StackType_t **stackS
 #endif
 }
 
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcbSpace, StackType_t **stackSpace, 
+  uint32_t *stackSize) 
+{
+  static StaticTask_t xTimerTaskTCB;
+  static StackType_t uxTimerTaskStack[ configTIMER_TASK_STACK_DEPTH ];
+  *tcbSpace = &xTimerTaskTCB;
+  *stackSpace  = &uxTimerTaskStack[0];
+  *stackSize = configTIMER_TASK_STACK_DEPTH;
+#ifdef ENABLE_THREAD_STATISTICS
+  using namespace jel;
+  static Thread::ThreadInfo ti =
+  {
+    Thread::Priority::maximum,
+    Thread::ExceptionHandlerPolicy::terminate,
+    &xTimerTaskTCB,
+    nullptr, nullptr, 
+    "timer",
+    configTIMER_TASK_STACK_DEPTH * 4,
+    nullptr,
+    nullptr,
+    true, false, 0,
+    jel::Duration::zero(),
+    jel::SteadyClock::zero()
+  };
+  Thread::schedulerAddIdleTask(&xTimerTaskTCB, &ti);
+#endif
+}
+
 void jel_threadCreate(volatile void* handle)
 {
   jel::Thread::schedulerThreadCreation(const_cast<void*>(handle));
@@ -51,18 +51,174 @@
 
 /** C/C++ Standard Library Headers */
 #include <cassert>
+#include <cstring>
 
 /** jel Library Headers */
 #include "os/api_locks.hpp"
 #include "os/api_exceptions.hpp"
 #include "os/api_system.hpp"
+#include "os/api_threads.hpp"
 #include "os/internal/indef.hpp"
 
 namespace jel
 {
 
+LockStatistics* LockStatistics::tableStart_ = nullptr;
+
+LockStatistics::LockStatistics(const void* lock, const char* kind, const bool tracksOwner)
+  noexcept : lock_{lock}, kind_{kind}, tracksOwner_{tracksOwner}, acquisitions_{0}, contended_{0},
+  timeouts_{0}, maxWait_us_{0}, maxHold_us_{0}, lastOwner_{nullptr}, totalWait_us_{0},
+  holdDepth_{0}, next_{nullptr}
+{
+  name_[0] = '\0';
+  //New locks are appended, so the table lists locks in construction order.
+  SchedulerLock schLock;
+  LockStatistics** link = &tableStart_;
+  while(*link != nullptr)
+  {
+    link = &(*link)->next_;
+  }
+  *link = this;
+}
+
+LockStatistics::~LockStatistics() noexcept
+{
+  SchedulerLock schLock;
+  LockStatistics** link = &tableStart_;
+  while(*link != nullptr && *link != this)
+  {
+    link = &(*link)->next_;
+  }
+  if(*link == this)
+  {
+    *link = next_;
+  }
+}
+
+void LockStatistics::setName(const char* name) noexcept
+{
+  std::strncpy(name_, name, maxNameLength_chars - 1);
+  name_[maxNameLength_chars - 1] = '\0';
+}
+
+void LockStatistics::recordLock(const bool acquired, const bool contended, const Duration& waited)
+  noexcept
+{
+  if(contended)
+  {
+    contended_++;
+    const auto us = static_cast<uint32_t>(waited.toMicroseconds());
+    {
+      CriticalSection cs;
+      totalWait_us_ += us;
+    }
+    uint32_t prevMax = maxWait_us_.load(std::memory_order_relaxed);
+    while(us > prevMax && !maxWait_us_.compare_exchange_weak(prevMax, us));
+  }
+  if(!acquired)
+  {
+    timeouts_++;
+    return;
+  }
+  acquisitions_++;
+  if(tracksOwner_ && (holdDepth_++ == 0))
+  {
+    lastOwner_ = xTaskGetCurrentTaskHandle();
+    holdStart_ = SteadyClock::now();
+  }
+}
+
+void LockStatistics::recordUnlock() noexcept
+{
+  if(tracksOwner_ && (holdDepth_ > 0) && (--holdDepth_ == 0))
+  {
+    //Only the owner writes the maximum hold time, so no compare-exchange is needed.
+    const Duration held = SteadyClock::now() - holdStart_;
+    const auto us = static_cast<uint32_t>(held.toMicroseconds());
+    if(us > maxHold_us_) { maxHold_us_ = us; }
+  }
+}
+
+void LockStatistics::reset() noexcept
+{
+  acquisitions_ = 0;
+  contended_ = 0;
+  timeouts_ = 0;
+  maxWait_us_ = 0;
+  maxHold_us_ = 0;
+  lastOwner_ = nullptr;
+  CriticalSection cs;
+  totalWait_us_ = 0;
+}
+
+void LockStatistics::copyTo(Snapshot& snap) const noexcept
+{
+  snap.lock = lock_;
+  std::memcpy(snap.name, name_, maxNameLength_chars);
+  snap.kind = kind_;
+  snap.acquisitions = acquisitions_;
+  snap.contended = contended_;
+  snap.timeouts = timeouts_;
+  snap.totalWait_us = totalWait_us_;
+  snap.maxWait_us = maxWait_us_;
+  snap.maxHold_us = maxHold_us_;
+  snap.lastOwner = lastOwner_;
+}
+
+size_t LockStatistics::snapshot(Snapshot* snapshots, const size_t maxLocks) noexcept
+{
+  //The scheduler lock keeps every entry alive while it is copied; locks are never destroyed from
+  //an interrupt.
+  SchedulerLock schLock;
+  size_t n = 0;
+  for(const LockStatistics* ls = tableStart_; (ls != nullptr) && (n < maxLocks); ls = ls->next_)
+  {
+    ls->copyTo(snapshots[n++]);
+  }
+  return n;
+}
+
+size_t LockStatistics::registeredLocks() noexcept
+{
+  SchedulerLock schLock;
+  size_t n = 0;
+  for(const LockStatistics* ls = tableStart_; ls != nullptr; ls = ls->next_)
+  {
+    n++;
+  }
+  return n;
+}
+
+void LockStatistics::resetAll() noexcept
+{
+  SchedulerLock schLock;
+  for(LockStatistics* ls = tableStart_; ls != nullptr; ls = ls->next_)
+  {
+    ls->reset();
+  }
+}
+
+#ifdef ENABLE_LOCK_STATISTICS
+static const char* lockKindName(const Lock::Type type) noexcept
+{
+  switch(type)
+  {
+    case Lock::Type::semaphore: return "sem";
+    case Lock::Type::countingSemaphore: return "csem";
+    case Lock::Type::mutex: return "mutex";
+    case Lock::Type::recursiveMutex: return "rmutex";
+    case Lock::Type::fastMutex: return "fmutex";
+    default: return "?";
+  }
+}
+#endif
+
 Lock::Lock(const Type type, const size_t maxCount, const size_t initialCount) :
   type_(type)
+#ifdef ENABLE_LOCK_STATISTICS
+  , stats_(this, lockKindName(type), (type == Type::mutex) || (type == Type::recursiveMutex) ||
+    (type == Type::fastMutex))
+#endif
 {
   //Ensure the memory required by the RTOS matches the size of the memory in the object.
   static_assert(sizeof(StaticMemoryBlock) == sizeof(StaticSemaphore_t), 
@@ -72,6 +228,7 @@ Lock::Lock(const Type type, const size_t maxCount, const size_t initialCount) :
   switch(type)
   {
     case Type::semaphore:
+    case Type::fastMutex:
       handle_ = xSemaphoreCreateBinaryStatic(mem);
       break;
     case Type::countingSemaphore:
@@ -96,6 +253,7 @@ Lock::Lock(const Type type, const size_t maxCount, const size_t initialCount) :
   switch(type)
   {
     case Type::countingSemaphore:
+    case Type::fastMutex: //The semaphore only parks waiters, so it starts empty.
       break;
     case Type::recursiveMutex:
       xSemaphoreGiveRecursive(handle_);
@@ -134,37 +292,64 @@ Status Lock::lock(const Duration& timeout) noexcept
         }
       case Type::mutex:
       case Type::recursiveMutex:
+      case Type::fastMutex:
       default:
         assert(false); //Cannot operate on a mutex in an ISR.
         return Status::failure;
     }
   }
+  else if(type_ == Type::fastMutex)
+  {
+    //The FastMutex records its own statistics.
+    return static_cast<FastMutex*>(this)->lock(timeout);
+  }
   else
   {
-    switch(type_)
+#ifdef ENABLE_LOCK_STATISTICS
+    //A failed immediate attempt marks the call as contended, and only the blocking take that
+    //follows is timed.
+    Status status = take(Duration::zero());
+    const bool contended = (status != Status::success);
+    Duration waited = Duration::zero();
+    if(contended && (timeout > Duration::zero()))
     {
-      case Type::semaphore:
-      case Type::countingSemaphore:
-      case Type::mutex:
+      const auto start = SteadyClock::now();
+      status = take(timeout);
+      waited = SteadyClock::now() - start;
+    }
+    stats_.recordLock(status == Status::success, contended, waited);
+    return status;
+#else
+    return take(timeout);
+#endif
+  }
+}
+
+Status Lock::take(const Duration& timeout) noexcept
+{
+  switch(type_)
+  {
+    case Type::semaphore:
+    case Type::countingSemaphore:
+    case Type::mutex:
+      {
+        if(xSemaphoreTake(handle_, toTicks(timeout)) == pdTRUE)
         {
-          if(xSemaphoreTake(handle_, toTicks(timeout)) == pdTRUE)
-          {
-            return Status::success;
-          }
-          return Status::failure;
+          return Status::success;
         }
-      case Type::recursiveMutex:
+        return Status::failure;
+      }
+    case Type::recursiveMutex:
+      {
+        if(xSemaphoreTakeRecursive(handle_, toTicks(timeout)) == pdTRUE)
         {
-          if(xSemaphoreTakeRecursive(handle_, toTicks(timeout)) == pdTRUE)
-          {
-            return Status::success;
-          }
-          return Status::failure;
+          return Status::success;
         }
-      default:
-        assert(false); //Illegal semaphore type.
         return Status::failure;
-    }
+      }
+    default:
+      assert(false); //Illegal semaphore type.
+      return Status::failure;
   }
 }
 
@@ -188,6 +373,7 @@ void Lock::unlock() noexcept
         }
       case Type::mutex:
       case Type::recursiveMutex:
+      case Type::fastMutex:
       default:
         assert(false); //Illegal to operate on a mutex in an ISR.
         return;
@@ -195,6 +381,12 @@ void Lock::unlock() noexcept
   }
   else
   {
+#ifdef ENABLE_LOCK_STATISTICS
+    if(type_ != Type::fastMutex)
+    {
+      stats_.recordUnlock();
+    }
+#endif
     switch(type_)
     {
       case Type::semaphore:
@@ -205,6 +397,9 @@ void Lock::unlock() noexcept
       case Type::recursiveMutex:
         xSemaphoreGiveRecursive(handle_);
         break;
+      case Type::fastMutex:
+        static_cast<FastMutex*>(this)->unlock();
+        break;
       default:
         assert(false); //Illegal lock type.
         return;
@@ -212,4 +407,874 @@ void Lock::unlock() noexcept
   }
 }
 
+void Lock::setName(const char* name) noexcept
+{
+#ifdef ENABLE_LOCK_STATISTICS
+  stats_.setName(name);
+#else
+  (void)name;
+#endif
+}
+
+const LockStatistics* Lock::statistics() const noexcept
+{
+#ifdef ENABLE_LOCK_STATISTICS
+  return &stats_;
+#else
+  return nullptr;
+#endif
+}
+
+uintptr_t FastMutex::currentThread() noexcept
+{
+  return reinterpret_cast<uintptr_t>(xTaskGetCurrentTaskHandle());
+}
+
+Status FastMutex::lockContended(const Duration& timeout) noexcept
+{
+  bool waited = false;
+#ifdef ENABLE_LOCK_STATISTICS
+  const auto start = SteadyClock::now();
+  const Status status = acquireContended(timeout, waited);
+  stats_.recordLock(status == Status::success, waited || (status != Status::success),
+    waited ? SteadyClock::now() - start : Duration::zero());
+  return status;
+#else
+  return acquireContended(timeout, waited);
+#endif
+}
+
+Status FastMutex::acquireContended(const Duration& timeout, bool& waited) noexcept
+{
+  const uintptr_t self = currentThread();
+  assert((self & contendedFlag) == 0);
+  assert((state_.load(std::memory_order_relaxed) & ~contendedFlag) != self); //Not recursive.
+  const auto start = SteadyClock::now();
+  while(true)
+  {
+    uintptr_t state = state_.load(std::memory_order_relaxed);
+    if(state == 0)
+    {
+      //Other threads may still be parked, so the mutex is taken with the contended flag set. At
+      //worst this costs the new owner one unnecessary semaphore give on unlock.
+      if(state_.compare_exchange_weak(state, self | contendedFlag, std::memory_order_acquire,
+        std::memory_order_relaxed))
+      {
+        return Status::success;
+      }
+      continue;
+    }
+    if(timeout <= Duration::zero())
+    {
+      return Status::failure;
+    }
+    if(((state & contendedFlag) == 0) && !state_.compare_exchange_weak(state,
+      state | contendedFlag, std::memory_order_relaxed))
+    {
+      continue;
+    }
+    inheritPriority(state & ~contendedFlag);
+    Duration remaining = timeout;
+    if(timeout != Duration::max())
+    {
+      remaining = timeout - (SteadyClock::now() - start);
+      if(remaining <= Duration::zero())
+      {
+        return Status::failure;
+      }
+    }
+    //A release between setting the flag and parking leaves the semaphore given, so the take below
+    //returns immediately and the loop retries; wakeups cannot be lost.
+    waited = true;
+    xSemaphoreTake(handle_, toTicks(remaining));
+  }
+}
+
+/** A thread's FastMutex priority inheritance record is packed into its jelFAST_MUTEX_TLS_INDEX
+ * thread local storage slot: the number of FastMutexes it holds that have been contended by a
+ * higher priority thread, and its base priority from before the first of them raised it. The slot
+ * is zero for threads that have not been raised. Only accessed with the scheduler locked. */
+static constexpr uintptr_t boostCountShift = 16;
+static constexpr uintptr_t boostPriorityMask = (1u << boostCountShift) - 1;
+
+static uintptr_t boostRecord(TaskHandle_t thread) noexcept
+{
+  return reinterpret_cast<uintptr_t>(pvTaskGetThreadLocalStoragePointer(thread,
+    jelFAST_MUTEX_TLS_INDEX));
+}
+
+static void setBoostRecord(TaskHandle_t thread, const uintptr_t count, const UBaseType_t base)
+  noexcept
+{
+  vTaskSetThreadLocalStoragePointer(thread, jelFAST_MUTEX_TLS_INDEX,
+    reinterpret_cast<void*>((count << boostCountShift) | (base & boostPriorityMask)));
+}
+
+void FastMutex::unlockContended() noexcept
+{
+  assert((state_.load(std::memory_order_relaxed) & ~contendedFlag) == currentThread());
+  //The scheduler is locked so that the woken waiter does not run until this thread's priority has
+  //been restored.
+  SchedulerLock lock;
+  state_.store(0, std::memory_order_release);
+  xSemaphoreGive(handle_);
+  if(boosted_)
+  {
+    boosted_ = false;
+    const uintptr_t record = boostRecord(nullptr);
+    const uintptr_t count = (record >> boostCountShift) - 1;
+    const UBaseType_t base = record & boostPriorityMask;
+    setBoostRecord(nullptr, count, base);
+    //Other FastMutexes that raised this thread may still have higher priority waiters, so the
+    //raised priority is kept until the last of them is released.
+    if(count == 0)
+    {
+      vTaskPrioritySet(nullptr, base);
+    }
+  }
+}
+
+void FastMutex::inheritPriority(const uintptr_t owner) noexcept
+{
+  const UBaseType_t priority = uxTaskPriorityGet(nullptr);
+  auto ownerHandle = reinterpret_cast<TaskHandle_t>(owner);
+  //With the scheduler locked the owner cannot run, so if the state still names it as the owner it
+  //cannot release the mutex (and restore its priority) while it is being raised.
+  SchedulerLock lock;
+  if((state_.load(std::memory_order_relaxed) & ~contendedFlag) != owner)
+  {
+    return;
+  }
+  if(boosted_)
+  {
+    //The mutex is already counted in the owner's record, a higher priority waiter only raises it
+    //further.
+    if(uxTaskPriorityGet(ownerHandle) < priority)
+    {
+      vTaskPrioritySet(ownerHandle, priority);
+    }
+    return;
+  }
+  //The current priority may already be raised by another FastMutex or a kernel mutex, so the
+  //base priority is compared against instead. Once raised through a FastMutex the kernel's base
+  //priority is the raised one, so the record's copy is used.
+  const uintptr_t record = boostRecord(ownerHandle);
+  const uintptr_t count = record >> boostCountShift;
+  UBaseType_t base = record & boostPriorityMask;
+  if(count == 0)
+  {
+    TaskStatus_t status;
+    vTaskGetInfo(ownerHandle, &status, pdFALSE, eInvalid);
+    base = status.uxBasePriority;
+  }
+  if(base >= priority)
+  {
+    return;
+  }
+  //The mutex is counted even if the owner is already running at a high enough priority, as that
+  //priority may be dropped when a different mutex is released while this waiter is still parked.
+  boosted_ = true;
+  setBoostRecord(ownerHandle, count + 1, base);
+  if(uxTaskPriorityGet(ownerHandle) < priority)
+  {
+    vTaskPrioritySet(ownerHandle, priority);
+  }
+}
+
+SharedMutex::SharedMutex() : state_{0}, drained_{1, 0}
+{
+  noWriter_.set(noWriterBit);
+}
+
+Status SharedMutex::lock(const Duration& timeout) noexcept
+{
+  assert(System::inIsr() == false);
+  const auto start = SteadyClock::now();
+  if(writerLock_.lock(timeout) != Status::success)
+  {
+    return Status::failure;
+  }
+  //The event bit is cleared before the flag is raised, so a reader that sees the flag always
+  //finds the bit clear (or set again by a later unlock()) and cannot miss its wakeup.
+  noWriter_.clear(noWriterBit);
+  uint32_t state = state_.fetch_or(writerFlag, std::memory_order_acquire);
+  while((state & ~writerFlag) != 0)
+  {
+    Duration remaining = timeout;
+    if(timeout != Duration::max())
+    {
+      remaining = timeout - (SteadyClock::now() - start);
+      if(remaining <= Duration::zero())
+      {
+        unlock();
+        return Status::failure;
+      }
+    }
+    //A give left over from a writer that timed out only causes another pass of the loop.
+    drained_.lock(remaining);
+    state = state_.load(std::memory_order_acquire);
+  }
+  return Status::success;
+}
+
+void SharedMutex::unlock() noexcept
+{
+  state_.fetch_and(~writerFlag, std::memory_order_release);
+  noWriter_.set(noWriterBit);
+  writerLock_.unlock();
+}
+
+Status SharedMutex::lock_shared(const Duration& timeout) noexcept
+{
+  assert(System::inIsr() == false);
+  const auto start = SteadyClock::now();
+  while(true)
+  {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    if((state & writerFlag) == 0)
+    {
+      if(state_.compare_exchange_weak(state, state + 1, std::memory_order_acquire,
+        std::memory_order_relaxed))
+      {
+        return Status::success;
+      }
+      continue;
+    }
+    Duration remaining = timeout;
+    if(timeout != Duration::max())
+    {
+      remaining = timeout - (SteadyClock::now() - start);
+      if(remaining <= Duration::zero())
+      {
+        return Status::failure;
+      }
+    }
+    noWriter_.waitAny(noWriterBit, remaining, false);
+  }
+}
+
+void SharedMutex::unlock_shared() noexcept
+{
+  //The last reader to leave lets a waiting writer in.
+  if(state_.fetch_sub(1, std::memory_order_release) == (writerFlag | 1))
+  {
+    drained_.unlock();
+  }
+}
+
+void Notification::notify(const uint32_t bits) noexcept
+{
+  switch(mode_)
+  {
+    case Mode::binary:
+      value_ = 1;
+      break;
+    case Mode::counting:
+      value_++;
+      break;
+    case Mode::bits:
+      value_ |= bits;
+      break;
+  }
+  //Only the notifier that claims the waiting thread gives the task notification.
+  auto waiter = static_cast<TaskHandle_t>(waiter_.exchange(nullptr));
+  if(waiter == nullptr)
+  {
+    return;
+  }
+  if(System::inIsr())
+  {
+    auto wakeHpTask = pdFALSE;
+    vTaskNotifyGiveFromISR(waiter, &wakeHpTask);
+    portYIELD_FROM_ISR(wakeHpTask);
+  }
+  else
+  {
+    xTaskNotifyGive(waiter);
+  }
+}
+
+template<typename TryFn>
+bool Notification::block(TryFn&& tryTake, const Duration& timeout) noexcept
+{
+  if(tryTake())
+  {
+    return true;
+  }
+  if(System::inIsr() || (timeout <= Duration::zero()))
+  {
+    return false;
+  }
+  void* self = xTaskGetCurrentTaskHandle();
+  //The waiter is published before the value is checked again, and notify() updates the value
+  //before claiming the waiter, so a notification can never fall between the two.
+  auto unpublish = [&]()
+  {
+    void* expected = self;
+    waiter_.compare_exchange_strong(expected, nullptr);
+  };
+  const auto start = SteadyClock::now();
+  while(true)
+  {
+    //Discard any stale wakeup left over from a previous wait before publishing ourselves.
+    ulTaskNotifyTake(pdTRUE, 0);
+    waiter_ = self;
+    if(tryTake())
+    {
+      unpublish();
+      return true;
+    }
+    Duration remaining = timeout;
+    if(timeout != Duration::max())
+    {
+      remaining = timeout - (SteadyClock::now() - start);
+      if(remaining <= Duration::zero())
+      {
+        unpublish();
+        return false;
+      }
+    }
+    ulTaskNotifyTake(pdTRUE, toTicks(remaining));
+    unpublish();
+    if(tryTake())
+    {
+      return true;
+    }
+  }
+}
+
+Status Notification::wait(const Duration& timeout) noexcept
+{
+  auto tryTake = [this]() 
+  {
+    uint32_t v = value_;
+    if(mode_ == Mode::counting)
+    {
+      while(v > 0 && !value_.compare_exchange_weak(v, v - 1));
+      return v > 0;
+    }
+    return value_.exchange(0) != 0;
+  };
+  return block(tryTake, timeout) ? Status::success : Status::failure;
+}
+
+Status Notification::waitUntilSet(const Duration& timeout) noexcept
+{
+  return block([this]() { return value_ != 0; }, timeout) ? Status::success : Status::failure;
+}
+
+uint32_t Notification::waitBits(const uint32_t mask, const Duration& timeout) noexcept
+{
+  assert(mode_ == Mode::bits);
+  uint32_t taken = 0;
+  auto tryTake = [&]()
+  {
+    taken = value_.fetch_and(~mask) & mask;
+    return taken != 0;
+  };
+  return block(tryTake, timeout) ? taken : 0;
+}
+
+#ifdef TARGET_SUPPORTS_CPPUTEST
+TEST_GROUP(JEL_TestGroup_Notification)
+{
+  static constexpr size_t BenchmarkIterations = 1000;
+  struct NotifierArgs
+  {
+    Notification* notification;
+    uint32_t count;
+    uint32_t bits;
+  };
+  static void notifierThread(void* args)
+  {
+    auto* na = static_cast<NotifierArgs*>(args);
+    for(uint32_t i = 0; i < na->count; i++)
+    {
+      ThisThread::sleepfor(Duration::milliseconds(1));
+      na->notification->notify(na->bits);
+    }
+    while(true)
+    {
+      ThisThread::sleepfor(Duration::seconds(1));
+    }
+  }
+  void setup()
+  {
+  }
+  void teardown()
+  {
+  }
+};
+TEST(JEL_TestGroup_Notification, BinaryAndCounting)
+{
+  Notification binary;
+  CHECK(binary.wait(Duration::zero()) != Status::success);
+  binary.notify();
+  binary.notify();
+  //Repeated binary notifications merge into one.
+  CHECK(binary.waitUntilSet(Duration::zero()) == Status::success);
+  CHECK(binary.wait(Duration::zero()) == Status::success);
+  CHECK(binary.wait(Duration::milliseconds(2)) != Status::success);
+  Notification counting{Notification::Mode::counting};
+  counting.notify();
+  counting.notify();
+  CHECK(counting.value() == 2);
+  CHECK(counting.wait(Duration::zero()) == Status::success);
+  CHECK(counting.wait(Duration::zero()) == Status::success);
+  CHECK(counting.wait(Duration::zero()) != Status::success);
+}
+TEST(JEL_TestGroup_Notification, BitsMode)
+{
+  Notification flags{Notification::Mode::bits};
+  flags.notify(0x5);
+  CHECK(flags.waitBits(0x2, Duration::zero()) == 0);
+  CHECK(flags.waitBits(0x3, Duration::zero()) == 0x1);
+  CHECK(flags.value() == 0x4);
+  CHECK(flags.waitBits(0xFF, Duration::zero()) == 0x4);
+  CHECK(flags.value() == 0);
+}
+TEST(JEL_TestGroup_Notification, WakesWaitingThread)
+{
+  constexpr uint32_t count = 20;
+  Notification n{Notification::Mode::counting};
+  NotifierArgs args{&n, count, 1};
+  Thread notifier{&notifierThread, &args, "notifier", 256, Thread::Priority::high};
+  for(uint32_t i = 0; i < count; i++)
+  {
+    CHECK(n.wait(Duration::milliseconds(100)) == Status::success);
+  }
+  CHECK(n.wait(Duration::milliseconds(5)) != Status::success);
+}
+TEST(JEL_TestGroup_Notification, SignalLatencyAgainstSemaphore)
+{
+  constexpr uint64_t cyclesPerUs = configCPU_CLOCK_HZ / 1'000'000;
+  Semaphore sem;
+  Notification n;
+  auto start = SteadyClock::now();
+  for(size_t i = 0; i < BenchmarkIterations; i++)
+  {
+    sem.unlock();
+    sem.lock(Duration::zero());
+  }
+  Duration semTime = SteadyClock::now() - start;
+  start = SteadyClock::now();
+  for(size_t i = 0; i < BenchmarkIterations; i++)
+  {
+    n.notify();
+    n.wait(Duration::zero());
+  }
+  Duration notificationTime = SteadyClock::now() - start;
+  UT_PRINT(StringFromFormat("signal/wait x%u: Semaphore %lldus (~%llu cycles/pair, %uB), "
+    "Notification %lldus (~%llu cycles/pair, %uB).", BenchmarkIterations,
+    semTime.toMicroseconds(), semTime.toMicroseconds() * cyclesPerUs / BenchmarkIterations,
+    sizeof(Semaphore), notificationTime.toMicroseconds(),
+    notificationTime.toMicroseconds() * cyclesPerUs / BenchmarkIterations,
+    sizeof(Notification)).asCharString());
+  CHECK(notificationTime < semTime);
+}
+TEST_GROUP(JEL_TestGroup_FastMutex)
+{
+  static constexpr size_t BenchmarkIterations = 1000;
+  static constexpr uint32_t IncrementsPerWorker = 200;
+  struct WorkerArgs
+  {
+    FastMutex* mutex;
+    uint32_t* counter;
+    std::atomic<uint32_t> finished;
+  };
+  struct HolderArgs
+  {
+    FastMutex* mutex;
+    std::atomic<bool> locked;
+    std::atomic<uint32_t> heldPriority;
+  };
+  static void incrementThread(void* args)
+  {
+    auto* wa = static_cast<WorkerArgs*>(args);
+    for(uint32_t i = 0; i < IncrementsPerWorker; i++)
+    {
+      LockGuard lg{*wa->mutex};
+      uint32_t value = *wa->counter;
+      //Yielding inside the critical section forces the other worker to contend for the mutex.
+      ThisThread::yield();
+      *wa->counter = value + 1;
+    }
+    wa->finished++;
+    while(true)
+    {
+      ThisThread::sleepfor(Duration::seconds(1));
+    }
+  }
+  static void holderThread(void* args)
+  {
+    auto* ha = static_cast<HolderArgs*>(args);
+    ha->mutex->lock();
+    ha->locked = true;
+    ThisThread::sleepfor(Duration::milliseconds(10));
+    ha->heldPriority = uxTaskPriorityGet(nullptr);
+    ha->mutex->unlock();
+    while(true)
+    {
+      ThisThread::sleepfor(Duration::seconds(1));
+    }
+  }
+  struct NestedHolderArgs
+  {
+    FastMutex* first;
+    FastMutex* second;
+    std::atomic<bool> locked;
+    std::atomic<bool> done;
+    std::atomic<uint32_t> afterFirstPriority;
+    std::atomic<uint32_t> afterBothPriority;
+  };
+  static void nestedHolderThread(void* args)
+  {
+    auto* ha = static_cast<NestedHolderArgs*>(args);
+    ha->first->lock();
+    ha->second->lock();
+    ha->locked = true;
+    ThisThread::sleepfor(Duration::milliseconds(20));
+    ha->first->unlock();
+    ha->afterFirstPriority = uxTaskPriorityGet(nullptr);
+    ha->second->unlock();
+    ha->afterBothPriority = uxTaskPriorityGet(nullptr);
+    ha->done = true;
+    while(true)
+    {
+      ThisThread::sleepfor(Duration::seconds(1));
+    }
+  }
+  static void waiterThread(void* args)
+  {
+    auto* mutex = static_cast<FastMutex*>(args);
+    if(mutex->lock(Duration::milliseconds(200)) == Status::success)
+    {
+      mutex->unlock();
+    }
+    while(true)
+    {
+      ThisThread::sleepfor(Duration::seconds(1));
+    }
+  }
+  void setup()
+  {
+  }
+  void teardown()
+  {
+  }
+};
+TEST(JEL_TestGroup_FastMutex, LockUnlock)
+{
+  FastMutex mutex;
+  CHECK(mutex.isLocked() == false);
+  CHECK(mutex.lock(Duration::zero()) == Status::success);
+  CHECK(mutex.isLocked());
+  mutex.unlock();
+  CHECK(mutex.isLocked() == false);
+  {
+    //Operations through the Lock base are forwarded to the FastMutex.
+    Lock& base = mutex;
+    LockGuard lg{base};
+    CHECK(mutex.isLocked());
+  }
+  CHECK(mutex.isLocked() == false);
+}
+TEST(JEL_TestGroup_FastMutex, MutualExclusion)
+{
+  FastMutex mutex;
+  uint32_t counter = 0;
+  WorkerArgs args{&mutex, &counter, {0}};
+  Thread w1{&incrementThread, &args, "fmWorker1", 256, Thread::Priority::high};
+  Thread w2{&incrementThread, &args, "fmWorker2", 256, Thread::Priority::high};
+  for(size_t i = 0; (i < 100) && (args.finished != 2); i++)
+  {
+    ThisThread::sleepfor(Duration::milliseconds(10));
+  }
+  CHECK(args.finished == 2);
+  CHECK(counter == 2 * IncrementsPerWorker);
+  CHECK(mutex.isLocked() == false);
+}
+TEST(JEL_TestGroup_FastMutex, PriorityInheritance)
+{
+  FastMutex mutex;
+  HolderArgs args{&mutex, {false}, {0}};
+  Thread holder{&holderThread, &args, "fmHolder", 256, Thread::Priority::low};
+  while(args.locked == false)
+  {
+    ThisThread::sleepfor(Duration::milliseconds(1));
+  }
+  const uint32_t priority = uxTaskPriorityGet(nullptr);
+  CHECK(mutex.lock(Duration::milliseconds(100)) == Status::success);
+  mutex.unlock();
+  if(priority > static_cast<uint32_t>(Thread::Priority::low))
+  {
+    //While this thread waited, the holder ran at this thread's priority.
+    CHECK(args.heldPriority == priority);
+  }
+}
+TEST(JEL_TestGroup_FastMutex, NestedPriorityInheritance)
+{
+  FastMutex first;
+  FastMutex second;
+  NestedHolderArgs args{&first, &second, {false}, {false}, {0}, {0}};
+  Thread holder{&nestedHolderThread, &args, "fmNestHolder", 256, Thread::Priority::low};
+  while(args.locked == false)
+  {
+    ThisThread::sleepfor(Duration::milliseconds(1));
+  }
+  Thread waiter{&waiterThread, &first, "fmNestWaiter", 256, Thread::Priority::normal};
+  const uint32_t priority = uxTaskPriorityGet(nullptr);
+  CHECK(second.lock(Duration::milliseconds(100)) == Status::success);
+  second.unlock();
+  for(size_t i = 0; (i < 100) && (args.done == false); i++)
+  {
+    ThisThread::sleepfor(Duration::milliseconds(1));
+  }
+  CHECK(args.done);
+  if(priority > static_cast<uint32_t>(Thread::Priority::low))
+  {
+    //Releasing the first mutex must not drop the holder's priority while this thread still waits
+    //on the second.
+    CHECK(args.afterFirstPriority >= priority);
+  }
+  CHECK(args.afterBothPriority == static_cast<uint32_t>(Thread::Priority::low));
+}
+TEST(JEL_TestGroup_FastMutex, UncontendedAgainstMutex)
+{
+  constexpr uint64_t cyclesPerUs = configCPU_CLOCK_HZ / 1'000'000;
+  Mutex mutex;
+  FastMutex fastMutex;
+  auto start = SteadyClock::now();
+  for(size_t i = 0; i < BenchmarkIterations; i++)
+  {
+    mutex.lock();
+    mutex.unlock();
+  }
+  Duration mutexTime = SteadyClock::now() - start;
+  start = SteadyClock::now();
+  for(size_t i = 0; i < BenchmarkIterations; i++)
+  {
+    fastMutex.lock();
+    fastMutex.unlock();
+  }
+  Duration fastTime = SteadyClock::now() - start;
+  UT_PRINT(StringFromFormat("lock/unlock x%u: Mutex %lldus (~%llu cycles/pair), "
+    "FastMutex %lldus (~%llu cycles/pair).", BenchmarkIterations, mutexTime.toMicroseconds(),
+    mutexTime.toMicroseconds() * cyclesPerUs / BenchmarkIterations, fastTime.toMicroseconds(),
+    fastTime.toMicroseconds() * cyclesPerUs / BenchmarkIterations).asCharString());
+  CHECK(fastTime < mutexTime);
+}
+TEST_GROUP(JEL_TestGroup_LockStatistics)
+{
+  struct HolderArgs
+  {
+    Lock* lock;
+    std::atomic<bool> locked;
+  };
+  static void holderThread(void* args)
+  {
+    auto* ha = static_cast<HolderArgs*>(args);
+    ha->lock->lock();
+    ha->locked = true;
+    //Held for several ticks, as a sleep may end up to one tick early.
+    ThisThread::sleepfor(Duration::milliseconds(30));
+    ha->lock->unlock();
+    while(true)
+    {
+      ThisThread::sleepfor(Duration::seconds(1));
+    }
+  }
+  void setup()
+  {
+  }
+  void teardown()
+  {
+  }
+};
+TEST(JEL_TestGroup_LockStatistics, MutexContention)
+{
+  Mutex mutex;
+  mutex.setName("test mutex");
+#ifndef ENABLE_LOCK_STATISTICS
+  CHECK(mutex.statistics() == nullptr);
+#else
+  const LockStatistics* ls = mutex.statistics();
+  CHECK(ls != nullptr);
+  STRCMP_EQUAL("test mutex", ls->name());
+  CHECK(mutex.lock() == Status::success);
+  mutex.unlock();
+  CHECK(ls->acquisitions() == 1);
+  CHECK(ls->contended() == 0);
+  CHECK(ls->lastOwner() == xTaskGetCurrentTaskHandle());
+  HolderArgs args{&mutex, {false}};
+  Thread holder{&holderThread, &args, "lsHolder", 256, Thread::Priority::high};
+  while(args.locked == false)
+  {
+    ThisThread::sleepfor(Duration::milliseconds(1));
+  }
+  CHECK(mutex.lock(Duration::milliseconds(100)) == Status::success);
+  mutex.unlock();
+  CHECK(ls->acquisitions() == 3);
+  CHECK(ls->contended() == 1);
+  CHECK(ls->timeouts() == 0);
+  //The holder kept the mutex for at least 20ms (30ms less up to one tick), and this thread
+  //started waiting at most one further tick later.
+  CHECK(ls->maxHold_us() >= 20'000);
+  CHECK(ls->maxWait_us() >= 10'000);
+  CHECK(ls->totalWait_us() == ls->maxWait_us());
+  CHECK(ls->lastOwner() == xTaskGetCurrentTaskHandle());
+  //The mutex must be listed in the statistics table.
+  const size_t total = LockStatistics::registeredLocks();
+  auto snaps = std::make_unique<LockStatistics::Snapshot[]>(total);
+  const size_t n = LockStatistics::snapshot(snaps.get(), total);
+  bool found = false;
+  for(size_t i = 0; i < n; i++)
+  {
+    if(snaps[i].lock == &mutex) { found = (snaps[i].contended == 1); }
+  }
+  CHECK(found);
+#endif
+}
+TEST(JEL_TestGroup_LockStatistics, SemaphoreTimeout)
+{
+  Semaphore sem;
+#ifdef ENABLE_LOCK_STATISTICS
+  const LockStatistics* ls = sem.statistics();
+  CHECK(sem.lock(Duration::zero()) == Status::success);
+  CHECK(sem.lock(Duration::milliseconds(2)) != Status::success);
+  CHECK(ls->acquisitions() == 1);
+  CHECK(ls->contended() == 1);
+  CHECK(ls->timeouts() == 1);
+  //Semaphores may be given by any thread, so no owner is recorded.
+  CHECK(ls->lastOwner() == nullptr);
+  CHECK(ls->maxHold_us() == 0);
+#else
+  CHECK(sem.statistics() == nullptr);
+#endif
+}
+TEST_GROUP(JEL_TestGroup_SharedMutex)
+{
+  static constexpr uint32_t ScalingReaders = 4;
+  static constexpr uint32_t ReadsPerReader = 5;
+  struct ReaderArgs
+  {
+    SharedMutex* shared;
+    Mutex* mutex;
+    std::atomic<uint32_t> finished;
+  };
+  struct WriterArgs
+  {
+    SharedMutex* shared;
+    std::atomic<bool> acquired;
+  };
+  /** Each read holds the lock across a short blocking call, as a reader formatting output or
+   * waiting on a peripheral would. Readers of a SharedMutex overlap these, readers of a Mutex
+   * cannot. */
+  static void readerThread(void* args)
+  {
+    auto* ra = static_cast<ReaderArgs*>(args);
+    for(uint32_t i = 0; i < ReadsPerReader; i++)
+    {
+      if(ra->shared != nullptr)
+      {
+        SharedLockGuard guard{ra->shared};
+        ThisThread::sleepfor(Duration::milliseconds(2));
+      }
+      else
+      {
+        LockGuard guard{ra->mutex};
+        ThisThread::sleepfor(Duration::milliseconds(2));
+      }
+    }
+    ra->finished++;
+    while(true)
+    {
+      ThisThread::sleepfor(Duration::seconds(1));
+    }
+  }
+  static void writerThread(void* args)
+  {
+    auto* wa = static_cast<WriterArgs*>(args);
+    {
+      ExclusiveLockGuard guard{wa->shared, Duration::milliseconds(100)};
+      wa->acquired = guard.isLocked();
+    }
+    while(true)
+    {
+      ThisThread::sleepfor(Duration::seconds(1));
+    }
+  }
+  static Duration timeReaders(SharedMutex* shared, Mutex* mutex)
+  {
+    ReaderArgs args{shared, mutex, {0}};
+    const auto start = SteadyClock::now();
+    Thread r1{&readerThread, &args, "rwReader1", 256, Thread::Priority::high};
+    Thread r2{&readerThread, &args, "rwReader2", 256, Thread::Priority::high};
+    Thread r3{&readerThread, &args, "rwReader3", 256, Thread::Priority::high};
+    Thread r4{&readerThread, &args, "rwReader4", 256, Thread::Priority::high};
+    while(args.finished != ScalingReaders)
+    {
+      ThisThread::sleepfor(Duration::milliseconds(1));
+    }
+    return SteadyClock::now() - start;
+  }
+  void setup()
+  {
+  }
+  void teardown()
+  {
+  }
+};
+TEST(JEL_TestGroup_SharedMutex, SharedAndExclusive)
+{
+  SharedMutex rw;
+  CHECK(rw.lock_shared(Duration::zero()) == Status::success);
+  CHECK(rw.lock_shared(Duration::zero()) == Status::success);
+  CHECK(rw.readers() == 2);
+  CHECK(rw.lock(Duration::milliseconds(2)) != Status::success);
+  //A writer that timed out must not leave readers locked out.
+  CHECK(rw.lock_shared(Duration::zero()) == Status::success);
+  rw.unlock_shared();
+  rw.unlock_shared();
+  rw.unlock_shared();
+  CHECK(rw.readers() == 0);
+  {
+    ExclusiveLockGuard writer{rw, Duration::zero()};
+    CHECK(writer.isLocked());
+    SharedLockGuard reader{rw, Duration::zero()};
+    CHECK(reader.isLocked() == false);
+  }
+  SharedLockGuard reader{rw, Duration::zero()};
+  CHECK(reader.isLocked());
+}
+TEST(JEL_TestGroup_SharedMutex, WaitingWriterBlocksNewReaders)
+{
+  SharedMutex rw;
+  WriterArgs args{&rw, {false}};
+  CHECK(rw.lock_shared() == Status::success);
+  Thread writer{&writerThread, &args, "rwWriter", 256, Thread::Priority::high};
+  ThisThread::sleepfor(Duration::milliseconds(2));
+  //The writer is waiting for this reader to leave, so a new reader must queue behind it.
+  CHECK(rw.lock_shared(Duration::milliseconds(2)) != Status::success);
+  CHECK(args.acquired == false);
+  rw.unlock_shared();
+  ThisThread::sleepfor(Duration::milliseconds(2));
+  CHECK(args.acquired);
+  CHECK(rw.lock_shared(Duration::zero()) == Status::success);
+  rw.unlock_shared();
+}
+TEST(JEL_TestGroup_SharedMutex, ReaderScaling)
+{
+  SharedMutex rw;
+  Mutex mutex;
+  const Duration mutexTime = timeReaders(nullptr, &mutex);
+  const Duration sharedTime = timeReaders(&rw, nullptr);
+  UT_PRINT(StringFromFormat("%u readers x%u reads: Mutex %lldus, SharedMutex %lldus.",
+    ScalingReaders, ReadsPerReader, mutexTime.toMicroseconds(),
+    sharedTime.toMicroseconds()).asCharString());
+  //Mutex readers run one at a time, SharedMutex readers all at once.
+  CHECK(sharedTime * 2 < mutexTime);
+}
+#endif
+
 } /** namespace jel */
@@ -146,7 +146,7 @@ Status Logger::fastPrint(const MessageType type, const char* cStr) noexcept
     //Masked out messages are always considered successfully 'printed'.
     return Status::success;
   }
-  return mq_->push({type, cStr}, Duration::zero());
+  return mq_->emplaceFor(Duration::zero(), type, cStr);
 }
 
 Status Logger::print(const MessageType type, const char* format, va_list vargs) 
@@ -165,6 +165,11 @@ Status Logger::print(const MessageType type, const char* format, va_list vargs)
     return Status::failure;
   }
   string.resize(printStat);
+  if(cfg_.useAsyncPrintThread)
+  {
+    //Construct the message directly in the queue slot rather than moving a local copy in.
+    return mq_->emplace(type, std::move(strContainer));
+  }
   PrintableMessage msg(type, std::move(strContainer));
   return messagePrint(msg);
 }
@@ -297,13 +302,10 @@ void Logger::printerThread(Logger* instance)
 
 void Logger::printerThreadImpl()
 {
-  PrintableMessage msg(MessageType::hidden, nullptr);
   while(true)
   {
-    if(mq_->pop(msg) == Status::success)
-    {
-      internalPrint(msg);
-    }
+    //Messages are printed straight from the popped slot, avoiding a move into a local message.
+    mq_->consume([this](PrintableMessage& msg) { internalPrint(msg); });
   }
 }
 
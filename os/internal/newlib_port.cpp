@@ -93,130 +93,128 @@ void __libc_fini_array(void);
 #endif
 void* operator new(size_t size)
 {
-  return jel::SystemAllocator::systemAllocator()->allocate(size);
+  return jel::SystemAllocator::systemAllocator()->allocate(size, __builtin_return_address(0));
 }
 
 void* operator new[](size_t size)
 {
-  return jel::SystemAllocator::systemAllocator()->allocate(size);
+  return jel::SystemAllocator::systemAllocator()->allocate(size, __builtin_return_address(0));
 }
 
 void operator delete(void* ptr) noexcept
 {
-  jel::SystemAllocator::systemAllocator()->deallocate(ptr);
+  jel::SystemAllocator::systemAllocator()->deallocate(ptr, __builtin_return_address(0));
 }
 
 void operator delete[](void* ptr) noexcept
 {
-  jel::SystemAllocator::systemAllocator()->deallocate(ptr);
+  jel::SystemAllocator::systemAllocator()->deallocate(ptr, __builtin_return_address(0));
 }
 
 void operator delete(void* ptr, size_t) noexcept
 {
-  jel::SystemAllocator::systemAllocator()->deallocate(ptr);
+  jel::SystemAllocator::systemAllocator()->deallocate(ptr, __builtin_return_address(0));
 }
 
 void operator delete[](void* ptr, size_t) noexcept
 {
-  jel::SystemAllocator::systemAllocator()->deallocate(ptr);
+  jel::SystemAllocator::systemAllocator()->deallocate(ptr, __builtin_return_address(0));
 }
 
 void* operator new(size_t size, char const*, int)
 {
-  return jel::SystemAllocator::systemAllocator()->allocate(size);
+  return jel::SystemAllocator::systemAllocator()->allocate(size, __builtin_return_address(0));
 }
 
 void operator delete(void* ptr, char const*, int ) 
 {
-  jel::SystemAllocator::systemAllocator()->deallocate(ptr);
+  jel::SystemAllocator::systemAllocator()->deallocate(ptr, __builtin_return_address(0));
 }
 
-auto mallocBase = [](size_t size)
+//The call site (the return address of the public malloc family function) is passed through so
+//allocation tracing records the code calling malloc, rather than these wrappers.
+auto mallocBase = [](size_t size, const void* callSite)
 {
-  void* ptr = jel::SystemAllocator::systemAllocator()->allocate(size);
+  void* ptr = jel::SystemAllocator::systemAllocator()->allocate(size, callSite);
   return ptr;
 };
 
-auto reallocBase = [](void* ptr, size_t size)
+auto reallocBase = [](void* ptr, size_t size, const void* callSite)
 {
-  void* newPtr = malloc(size);
-  if(newPtr == nullptr) { return newPtr; }
-  std::memcpy(newPtr, ptr, size);
-  free(ptr);
-  return newPtr;
+  return jel::SystemAllocator::systemAllocator()->reallocate(ptr, size, callSite);
 };
 
-auto callocBase = [](size_t num, size_t size)
+auto callocBase = [](size_t num, size_t size, const void* callSite)
 {
-  void* ptr = malloc(size * num);
+  void* ptr = mallocBase(size * num, callSite);
   if(ptr == nullptr) { return ptr; }
   std::memset(ptr, 0, size * num);
   return ptr;
 };
 
-auto freeBase = [](void* ptr)
+auto freeBase = [](void* ptr, const void* callSite)
 {
-  jel::SystemAllocator::systemAllocator()->deallocate(ptr);
+  jel::SystemAllocator::systemAllocator()->deallocate(ptr, callSite);
 };
 
 void* malloc(size_t size)
 {
-  return mallocBase(size);
+  return mallocBase(size, __builtin_return_address(0));
 }
 
 void* realloc(void* ptr, size_t size)
 {
-  return reallocBase(ptr, size);
+  return reallocBase(ptr, size, __builtin_return_address(0));
 }
 
 void* calloc(size_t num, size_t size)
 {
-  return callocBase(num, size);
+  return callocBase(num, size, __builtin_return_address(0));
 }
 
 void free(void* ptr)
 {
-  return freeBase(ptr);
+  return freeBase(ptr, __builtin_return_address(0));
 }
 
 void* __wrap_malloc(size_t size)
 {
-  return mallocBase(size);
+  return mallocBase(size, __builtin_return_address(0));
 }
 
 void* __wrap_realloc(void* ptr, size_t size)
 {
-  return reallocBase(ptr, size);
+  return reallocBase(ptr, size, __builtin_return_address(0));
 }
 
 void* __wrap_calloc(size_t num, size_t size)
 {
-  return callocBase(num, size);
+  return callocBase(num, size, __builtin_return_address(0));
 }
 
 void __wrap_free(void* ptr)
 {
-  return freeBase(ptr);
+  return freeBase(ptr, __builtin_return_address(0));
 }
 
 void* __wrap__malloc_r(void*, size_t size)
 {
-  return mallocBase(size);
+  return mallocBase(size, __builtin_return_address(0));
 }
 
 void* __wrap__realloc_r(void*, void* ptr, size_t size)
 {
-  return reallocBase(ptr, size);
+  return reallocBase(ptr, size, __builtin_return_address(0));
 }
 
 void* __wrap__calloc_r(void*, size_t num, size_t size)
 {
-  return callocBase(num, size);
+  return callocBase(num, size, __builtin_return_address(0));
 }
 
 void __wrap__free_r(void*, void* ptr)
 {
-  return freeBase(ptr);
+  return freeBase(ptr, __builtin_return_address(0));
 }
 
 void __malloc_lock()
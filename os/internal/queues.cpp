@@ -28,18 +28,153 @@
 
 /** C/C++ Standard Library Headers */
 #include <cassert>
+#include <cstring>
 
 /** jel Library Headers */
 #include "os/api_queues.hpp"
+#include "os/api_allocator.hpp"
 #include "os/api_exceptions.hpp"
 #include "os/api_system.hpp"
+#include "os/api_threads.hpp"
 #include "os/internal/indef.hpp"
 
 namespace jel
 {
 
+QueueStatistics* QueueStatistics::tableStart_ = nullptr;
+
+QueueStatistics::QueueStatistics(const size_t capacity) noexcept :
+  queue_{nullptr}, capacity_{capacity}, next_{nullptr}
+{
+  reset();
+  name_[0] = '\0';
+  //New queues are appended, so the table lists queues in construction order.
+  SchedulerLock schLock;
+  QueueStatistics** link = &tableStart_;
+  while(*link != nullptr)
+  {
+    link = &(*link)->next_;
+  }
+  *link = this;
+}
+
+QueueStatistics::~QueueStatistics() noexcept
+{
+  SchedulerLock schLock;
+  QueueStatistics** link = &tableStart_;
+  while(*link != nullptr && *link != this)
+  {
+    link = &(*link)->next_;
+  }
+  if(*link == this)
+  {
+    *link = next_;
+  }
+}
+
+void QueueStatistics::setName(const char* name) noexcept
+{
+  std::strncpy(name_, name, maxNameLength_chars - 1);
+  name_[maxNameLength_chars - 1] = '\0';
+}
+
+void QueueStatistics::recordPush(const size_t count, const size_t depth) noexcept
+{
+  pushes_ += count;
+  size_t prevMax = maxDepth_.load(std::memory_order_relaxed);
+  while(depth > prevMax && !maxDepth_.compare_exchange_weak(prevMax, depth));
+}
+
+void QueueStatistics::recordPop(const size_t count) noexcept
+{
+  pops_ += count;
+}
+
+void QueueStatistics::recordFailure(const bool isPush) noexcept
+{
+  if(isPush) { pushFailures_++; } else { popFailures_++; }
+}
+
+void QueueStatistics::recordWait(const Duration& waited) noexcept
+{
+  const int64_t us = waited.toMicroseconds();
+  size_t bin = 0;
+  while((bin < waitHistogramBins - 1) && (us >= waitBinLimits_us[bin]))
+  {
+    bin++;
+  }
+  waits_[bin]++;
+}
+
+void QueueStatistics::reset() noexcept
+{
+  maxDepth_ = 0;
+  pushes_ = 0;
+  pops_ = 0;
+  pushFailures_ = 0;
+  popFailures_ = 0;
+  for(auto& w : waits_)
+  {
+    w = 0;
+  }
+}
+
+void QueueStatistics::copyTo(Snapshot& snap) const noexcept
+{
+  snap.queue = queue_;
+  std::memcpy(snap.name, name_, maxNameLength_chars);
+  snap.capacity = capacity_;
+  snap.depth = (queue_ != nullptr) ? 
+    uxQueueMessagesWaiting(static_cast<QueueHandle_t>(const_cast<void*>(queue_))) : 0;
+  snap.maxDepth = maxDepth_;
+  snap.pushes = pushes_;
+  snap.pops = pops_;
+  snap.pushFailures = pushFailures_;
+  snap.popFailures = popFailures_;
+  for(size_t i = 0; i < waitHistogramBins; i++)
+  {
+    snap.waits[i] = waits_[i];
+  }
+}
+
+size_t QueueStatistics::snapshot(Snapshot* snapshots, const size_t maxQueues) noexcept
+{
+  //The scheduler lock keeps every entry alive while it is copied; queues are never destroyed from
+  //an interrupt.
+  SchedulerLock schLock;
+  size_t n = 0;
+  for(const QueueStatistics* qs = tableStart_; (qs != nullptr) && (n < maxQueues); qs = qs->next_)
+  {
+    qs->copyTo(snapshots[n++]);
+  }
+  return n;
+}
+
+size_t QueueStatistics::registeredQueues() noexcept
+{
+  SchedulerLock schLock;
+  size_t n = 0;
+  for(const QueueStatistics* qs = tableStart_; qs != nullptr; qs = qs->next_)
+  {
+    n++;
+  }
+  return n;
+}
+
+void QueueStatistics::resetAll() noexcept
+{
+  SchedulerLock schLock;
+  for(QueueStatistics* qs = tableStart_; qs != nullptr; qs = qs->next_)
+  {
+    qs->reset();
+  }
+}
+
 GenericCopyQueue_Base::GenericCopyQueue_Base(const size_t maxLength, const size_t itemSize, uint8_t* memory) :
-  itemStoragePtr_(memory)
+  itemStoragePtr_(memory), itemSize_(itemSize)
+#ifdef ENABLE_QUEUE_STATISTICS
+  , stats_(maxLength)
+#endif
 {
   static_assert(sizeof(CbStorage) == sizeof(StaticQueue_t), 
     "Static queue storage size must be equal to underlying OS primitive size.");
@@ -49,16 +184,75 @@ GenericCopyQueue_Base::GenericCopyQueue_Base(const size_t maxLength, const size_
     throw Exception{ExceptionCode::queueConstructionFailed,
       "Failed while constructing queue."};
   }
+#ifdef ENABLE_QUEUE_STATISTICS
+  stats_.attach(handle_);
+#endif
 }
 
 GenericCopyQueue_Base::~GenericCopyQueue_Base() noexcept
 {
   if(handle_ != nullptr)
   {
+#ifdef ENABLE_QUEUE_STATISTICS
+    //Detach under the scheduler lock so a concurrent snapshot never reads a deleted queue.
+    {
+      SchedulerLock schLock;
+      stats_.attach(nullptr);
+    }
+#endif
     vQueueDelete(handle_);
   }
 }
 
+template<typename Op>
+bool GenericCopyQueue_Base::blockingOp(Op&& op, const Duration& timeout) noexcept
+{
+#ifdef ENABLE_QUEUE_STATISTICS
+  //Try without blocking first, so that only operations that really have to wait are timed.
+  if(op(0))
+  {
+    return true;
+  }
+  if(timeout <= Duration::zero())
+  {
+    return false;
+  }
+  auto start = SteadyClock::now();
+  bool ok = op(toTicks(timeout));
+  stats_.recordWait(SteadyClock::now() - start);
+  return ok;
+#else
+  return op(toTicks(timeout));
+#endif
+}
+
+void GenericCopyQueue_Base::recordPush(const size_t count) noexcept
+{
+#ifdef ENABLE_QUEUE_STATISTICS
+  stats_.recordPush(count, genericGetSize());
+#else
+  (void)count;
+#endif
+}
+
+void GenericCopyQueue_Base::recordPop(const size_t count) noexcept
+{
+#ifdef ENABLE_QUEUE_STATISTICS
+  stats_.recordPop(count);
+#else
+  (void)count;
+#endif
+}
+
+void GenericCopyQueue_Base::recordFailure(const bool isPush) noexcept
+{
+#ifdef ENABLE_QUEUE_STATISTICS
+  stats_.recordFailure(isPush);
+#else
+  (void)isPush;
+#endif
+}
+
 Status GenericCopyQueue_Base::genericPush(const void* item, const Duration& timeout) noexcept
 {
   assert(item);  
@@ -67,19 +261,24 @@ Status GenericCopyQueue_Base::genericPush(const void* item, const Duration& time
     auto wakeHpTask = pdFALSE;  
     if(xQueueSendToBackFromISR(handle_, item, &wakeHpTask) == pdTRUE)  
     {  
+      recordPush(1);
       portYIELD_FROM_ISR(wakeHpTask);  
       return Status::success;  
     }  
+    recordFailure(true);
     return Status::failure;  
   }  
   else  
   {  
-    if(xQueueSendToBack(handle_, item, toTicks(timeout)) == pdTRUE)  
+    auto send = [&](TickType_t ticks) { return xQueueSendToBack(handle_, item, ticks) == pdTRUE; };
+    if(blockingOp(send, timeout))
     {  
+      recordPush(1);
       return Status::success;  
     }  
     else  
     {  
+      recordFailure(true);
       return Status::failure;  
     }  
   }
@@ -94,19 +293,24 @@ Status GenericCopyQueue_Base::genericPushToFront(const void* item, const Duratio
     auto wakeHpTask = pdFALSE;  
     if(xQueueSendToFrontFromISR(handle_, item, &wakeHpTask) == pdTRUE)  
     {  
+      recordPush(1);
       portYIELD_FROM_ISR(wakeHpTask);  
       return Status::success;  
     }  
+    recordFailure(true);
     return Status::failure;  
   }  
   else  
   {  
-    if(xQueueSendToFront(handle_, item, toTicks(timeout)) == pdTRUE)  
+    auto send = [&](TickType_t ticks) { return xQueueSendToFront(handle_, item, ticks) == pdTRUE; };
+    if(blockingOp(send, timeout))
     {  
+      recordPush(1);
       return Status::success;  
     }  
     else  
     {  
+      recordFailure(true);
       return Status::failure;  
     }  
   }
@@ -120,24 +324,120 @@ Status GenericCopyQueue_Base::genericPop(void* item, const Duration& timeout) no
     auto wakeHpTask = pdFALSE;  
     if(xQueueReceiveFromISR(handle_, item, &wakeHpTask) == pdTRUE)  
     {  
+      recordPop(1);
       portYIELD_FROM_ISR(wakeHpTask);  
       return Status::success;  
     }  
+    recordFailure(false);
     return Status::failure;  
   }  
   else  
   {  
-    if(xQueueReceive(handle_, item, toTicks(timeout)) == pdTRUE)  
+    auto receive = [&](TickType_t ticks) { return xQueueReceive(handle_, item, ticks) == pdTRUE; };
+    if(blockingOp(receive, timeout))
     {  
+      recordPop(1);
       return Status::success;  
     }  
     else  
     {  
+      recordFailure(false);
       return Status::failure;  
     }  
   }
 }
 
+size_t GenericCopyQueue_Base::pushBatch(const uint8_t* items, const size_t count) noexcept
+{
+  //With the scheduler suspended a consumer woken by the first send is not switched to until the
+  //whole batch is queued, so the batch costs a single context switch.
+  SchedulerLock lock;
+  size_t pushed = 0;
+  while((pushed < count) && (xQueueSendToBack(handle_, items + pushed * itemSize_, 0) == pdTRUE))
+  {
+    pushed++;
+  }
+  return pushed;
+}
+
+size_t GenericCopyQueue_Base::popBatch(uint8_t* items, const size_t maxCount) noexcept
+{
+  SchedulerLock lock;
+  size_t popped = 0;
+  while((popped < maxCount) && (xQueueReceive(handle_, items + popped * itemSize_, 0) == pdTRUE))
+  {
+    popped++;
+  }
+  return popped;
+}
+
+size_t GenericCopyQueue_Base::genericPushN(const void* items, const size_t count,
+  const Duration& timeout) noexcept
+{
+  assert(items || (count == 0));
+  auto src = static_cast<const uint8_t*>(items);
+  if(count == 0)
+  {
+    return 0;
+  }
+  size_t pushed = 0;
+  if(System::inIsr())
+  {
+    auto wakeHpTask = pdFALSE;
+    while((pushed < count) && 
+      (xQueueSendToBackFromISR(handle_, src + pushed * itemSize_, &wakeHpTask) == pdTRUE))
+    {
+      pushed++;
+    }
+    portYIELD_FROM_ISR(wakeHpTask);
+  }
+  else
+  {
+    pushed = pushBatch(src, count);
+    //The queue is full; block for space for the first item only, then batch the remainder.
+    if((pushed == 0) && (timeout > Duration::zero()) && blockingOp(
+      [&](TickType_t ticks) { return xQueueSendToBack(handle_, src, ticks) == pdTRUE; }, timeout))
+    {
+      pushed = 1 + pushBatch(src + itemSize_, count - 1);
+    }
+  }
+  if(pushed > 0) { recordPush(pushed); } else { recordFailure(true); }
+  return pushed;
+}
+
+size_t GenericCopyQueue_Base::genericPopN(void* items, const size_t maxCount,
+  const Duration& timeout) noexcept
+{
+  assert(items || (maxCount == 0));
+  auto dst = static_cast<uint8_t*>(items);
+  if(maxCount == 0)
+  {
+    return 0;
+  }
+  size_t popped = 0;
+  if(System::inIsr())
+  {
+    auto wakeHpTask = pdFALSE;
+    while((popped < maxCount) &&
+      (xQueueReceiveFromISR(handle_, dst + popped * itemSize_, &wakeHpTask) == pdTRUE))
+    {
+      popped++;
+    }
+    portYIELD_FROM_ISR(wakeHpTask);
+  }
+  else
+  {
+    popped = popBatch(dst, maxCount);
+    if((popped == 0) && (timeout > Duration::zero()) && blockingOp(
+      [&](TickType_t ticks) { return xQueueReceive(handle_, dst, ticks) == pdTRUE; }, timeout))
+    {
+      popped = 1 + popBatch(dst + itemSize_, maxCount - 1);
+    }
+  }
+  if(popped > 0) { recordPop(popped); } else { recordFailure(false); }
+  return popped;
+}
+
 size_t GenericCopyQueue_Base::genericGetSize() const noexcept
 {
   if(System::inIsr()) { return uxQueueMessagesWaitingFromISR(handle_); }
@@ -154,6 +454,155 @@ void GenericCopyQueue_Base::genericErase() noexcept
   xQueueReset(handle_);
 }
 
+void GenericCopyQueue_Base::genericSetName(const char* name) noexcept
+{
+#ifdef ENABLE_QUEUE_STATISTICS
+  stats_.setName(name);
+#else
+  (void)name;
+#endif
+}
+
+const QueueStatistics* GenericCopyQueue_Base::genericStatistics() const noexcept
+{
+#ifdef ENABLE_QUEUE_STATISTICS
+  return &stats_;
+#else
+  return nullptr;
+#endif
+}
+
+WaitSet::WaitSet(const size_t eventCapacity) : ready_{nullptr}, members_{}, memberCount_{0}
+{
+  handle_ = xQueueCreateSet(eventCapacity);
+  if(handle_ == nullptr)
+  {
+    throw Exception{ExceptionCode::queueConstructionFailed,
+      "Failed while constructing wait set."};
+  }
+}
+
+WaitSet::~WaitSet() noexcept
+{
+  //Members hold a pointer to the set, so they must all be detached before it is deleted.
+  while(memberCount_ > 0)
+  {
+    if(removeMember(members_[memberCount_ - 1]) != Status::success)
+    {
+      assert(!"WaitSet members must be drained before the WaitSet is destroyed.");
+      memberCount_--;
+    }
+  }
+  vQueueDelete(handle_);
+}
+
+Status WaitSet::addMember(Handle member) noexcept
+{
+  assert(member);
+  if(memberCount_ >= maxMembers)
+  {
+    return Status::failure;
+  }
+  if(xQueueAddToSet(member, handle_) != pdPASS)
+  {
+    return Status::failure;
+  }
+  members_[memberCount_++] = member;
+  return Status::success;
+}
+
+Status WaitSet::removeMember(Handle member) noexcept
+{
+  for(size_t i = 0; i < memberCount_; i++)
+  {
+    if(members_[i] == member)
+    {
+      if(xQueueRemoveFromSet(member, handle_) != pdPASS)
+      {
+        return Status::failure;
+      }
+      members_[i] = members_[--memberCount_];
+      if(ready_ == member)
+      {
+        ready_ = nullptr;
+      }
+      return Status::success;
+    }
+  }
+  return Status::failure;
+}
+
+Status WaitSet::wait(const Duration& timeout) noexcept
+{
+  if(System::inIsr())
+  {
+    ready_ = xQueueSelectFromSetFromISR(handle_);
+  }
+  else
+  {
+    ready_ = xQueueSelectFromSet(handle_, toTicks(timeout));
+  }
+  return ready_ != nullptr ? Status::success : Status::failure;
+}
+
+void SpscQueue_Base::wakeConsumer() noexcept
+{
+  //Only the producer that claims the waiting consumer gives the notification.
+  auto consumer = static_cast<TaskHandle_t>(consumer_.exchange(nullptr, std::memory_order_acq_rel));
+  if(consumer == nullptr)
+  {
+    return;
+  }
+  if(System::inIsr())
+  {
+    auto wakeHpTask = pdFALSE;
+    vTaskNotifyGiveFromISR(consumer, &wakeHpTask);
+    portYIELD_FROM_ISR(wakeHpTask);
+  }
+  else
+  {
+    xTaskNotifyGive(consumer);
+  }
+}
+
+bool SpscQueue_Base::waitForData(const std::atomic<size_t>& tail, const size_t head,
+  const Duration& timeout) noexcept
+{
+  if(System::inIsr())
+  {
+    return false;
+  }
+  const auto start = SteadyClock::now();
+  while(true)
+  {
+    //Discard any stale wakeup left over from a previous wait before publishing ourselves.
+    ulTaskNotifyTake(pdTRUE, 0);
+    consumer_.store(xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(tail.load(std::memory_order_acquire) != head)
+    {
+      consumer_.store(nullptr, std::memory_order_relaxed);
+      return true;
+    }
+    Duration remaining = timeout;
+    if(timeout != Duration::max())
+    {
+      remaining = timeout - (SteadyClock::now() - start);
+      if(remaining <= Duration::zero())
+      {
+        consumer_.store(nullptr, std::memory_order_relaxed);
+        return false;
+      }
+    }
+    ulTaskNotifyTake(pdTRUE, toTicks(remaining));
+    consumer_.store(nullptr, std::memory_order_relaxed);
+    if(tail.load(std::memory_order_acquire) != head)
+    {
+      return true;
+    }
+  }
+}
+
 #ifdef TARGET_SUPPORTS_CPPUTEST
 TEST_GROUP(JEL_TestGroup_Queues_Pod)
 {
@@ -195,5 +644,492 @@ TEST(JEL_TestGroup_Queues_Pod, PushPop)
   CHECK(queuePtr->pop(s, jel::Duration::zero()) != Status::success);
   CHECK(queuePtr->pop(s, jel::Duration::milliseconds(5)) != Status::success);
 }
+TEST(JEL_TestGroup_Queues_Pod, StaticQueueUsesNoHeap)
+{
+  using SQ = StaticQueue<PodStruct, QueueSize_Items>;
+  static_assert(SQ::itemStorage_Bytes() == sizeof(PodStruct) * QueueSize_Items,
+    "StaticQueue item storage must be exactly sized.");
+#ifdef ENABLE_QUEUE_STATISTICS
+  constexpr size_t statistics_Bytes = sizeof(QueueStatistics);
+#else
+  constexpr size_t statistics_Bytes = 0;
+#endif
+  static_assert(SQ::footprint_Bytes() < SQ::itemStorage_Bytes() + 128 + statistics_Bytes,
+    "StaticQueue overhead is larger than expected.");
+  auto* alloc = SystemAllocator::systemAllocator();
+  //Lock the scheduler so no other thread can touch the heap while the counts are sampled.
+  SchedulerLock lock;
+  const size_t allocs = alloc->totalAllocations();
+  const size_t freeBytes = alloc->freeSpace_Bytes();
+  {
+    SQ sq;
+    PodStruct s;
+    for(size_t i = 0; i < QueueSize_Items; i++)
+    {
+      CHECK(sq.push(s, Duration::zero()) == Status::success);
+    }
+    CHECK(sq.push(s, Duration::zero()) != Status::success);
+    CHECK(sq.size() == QueueSize_Items);
+    CHECK(sq.pop(s, Duration::zero()) == Status::success);
+  }
+  CHECK(alloc->totalAllocations() == allocs);
+  {
+    Queue<PodStruct> q{QueueSize_Items};
+    CHECK(alloc->totalAllocations() == allocs + 1);
+  }
+  //The heap backed queue must return its item storage on destruction.
+  CHECK(alloc->freeSpace_Bytes() == freeBytes);
+}
+TEST(JEL_TestGroup_Queues_Pod, BatchPushPop)
+{
+  Queue<uint32_t> q{QueueSize_Items};
+  uint32_t in[QueueSize_Items + 8];
+  uint32_t out[QueueSize_Items * 2];
+  for(uint32_t i = 0; i < QueueSize_Items + 8; i++)
+  {
+    in[i] = i;
+  }
+  CHECK(q.pushN(in, 10, Duration::zero()) == 10);
+  //Only the free space is filled; the batch does not block for the rest.
+  CHECK(q.pushN(in + 10, QueueSize_Items, Duration::zero()) == QueueSize_Items - 10);
+  CHECK(q.pushN(in, 1, Duration::milliseconds(2)) == 0);
+  CHECK(q.popN(out, QueueSize_Items * 2, Duration::zero()) == QueueSize_Items);
+  for(uint32_t i = 0; i < QueueSize_Items; i++)
+  {
+    CHECK(out[i] == i);
+  }
+  CHECK(q.popN(out, QueueSize_Items, Duration::milliseconds(2)) == 0);
+}
+TEST(JEL_TestGroup_Queues_Pod, BatchThroughput)
+{
+  constexpr size_t batches = 100;
+  Queue<uint32_t> q{QueueSize_Items};
+  uint32_t buffer[QueueSize_Items] = {};
+  auto start = SteadyClock::now();
+  for(size_t b = 0; b < batches; b++)
+  {
+    for(size_t i = 0; i < QueueSize_Items; i++)
+    {
+      q.push(buffer[i], Duration::zero());
+    }
+    for(size_t i = 0; i < QueueSize_Items; i++)
+    {
+      q.pop(buffer[i], Duration::zero());
+    }
+  }
+  Duration singleTime = SteadyClock::now() - start;
+  start = SteadyClock::now();
+  for(size_t b = 0; b < batches; b++)
+  {
+    CHECK(q.pushN(buffer, QueueSize_Items, Duration::zero()) == QueueSize_Items);
+    CHECK(q.popN(buffer, QueueSize_Items, Duration::zero()) == QueueSize_Items);
+  }
+  Duration batchTime = SteadyClock::now() - start;
+  UT_PRINT(StringFromFormat("%u x %u items: %lldus single push/pop, %lldus pushN/popN.", batches,
+    QueueSize_Items, singleTime.toMicroseconds(), batchTime.toMicroseconds()).asCharString());
+}
+TEST(JEL_TestGroup_Queues_Pod, FreeSpaceAndClear)
+{
+  Queue<uint32_t> q{QueueSize_Items};
+  CHECK(q.freeSpace() == QueueSize_Items);
+  for(uint32_t i = 0; i < 5; i++)
+  {
+    CHECK(q.push(i, Duration::zero()) == Status::success);
+  }
+  CHECK(q.freeSpace() == QueueSize_Items - 5);
+  q.clear();
+  CHECK(q.empty());
+  CHECK(q.freeSpace() == QueueSize_Items);
+}
+TEST(JEL_TestGroup_Queues_Pod, Statistics)
+{
+  Queue<uint32_t> q{4};
+  q.setName("test queue");
+#ifndef ENABLE_QUEUE_STATISTICS
+  CHECK(q.statistics() == nullptr);
+#else
+  const QueueStatistics* qs = q.statistics();
+  CHECK(qs != nullptr);
+  STRCMP_EQUAL("test queue", qs->name());
+  uint32_t v = 0;
+  CHECK(q.push(v, Duration::zero()) == Status::success);
+  CHECK(q.push(v, Duration::zero()) == Status::success);
+  CHECK(q.pop(v, Duration::zero()) == Status::success);
+  CHECK(q.pop(v, Duration::zero()) == Status::success);
+  //An empty pop with a timeout blocks for several ticks (20ms-30ms with a 10ms tick), landing in
+  //the 10ms-100ms wait bin.
+  CHECK(q.pop(v, Duration::milliseconds(30)) != Status::success);
+  CHECK(qs->pushes() == 2);
+  CHECK(qs->pops() == 2);
+  CHECK(qs->maxDepth() == 2);
+  CHECK(qs->pushFailures() == 0);
+  CHECK(qs->popFailures() == 1);
+  CHECK(qs->waits(3) == 1);
+  //The queue must be listed in the statistics table.
+  const size_t total = QueueStatistics::registeredQueues();
+  auto snaps = std::make_unique<QueueStatistics::Snapshot[]>(total);
+  const size_t n = QueueStatistics::snapshot(snaps.get(), total);
+  bool found = false;
+  for(size_t i = 0; i < n; i++)
+  {
+    if(snaps[i].queue == qs->queue()) { found = (snaps[i].pops == 2); }
+  }
+  CHECK(found);
+#endif
+}
+TEST(JEL_TestGroup_Queues_Pod, WaitSetSelectsReadyMember)
+{
+  Queue<uint32_t> q{4};
+  Semaphore sem;
+  CountingSemaphore counter{2, 0};
+  //Semaphores are created available, and may only join a set while unavailable.
+  CHECK(sem.lock(Duration::zero()) == Status::success);
+  WaitSet ws{4 + 1 + 2};
+  CHECK(ws.add(q) == Status::success);
+  CHECK(ws.add(sem) == Status::success);
+  CHECK(ws.add(counter) == Status::success);
+  CHECK(ws.size() == 3);
+  CHECK(ws.wait(Duration::milliseconds(2)) != Status::success);
+
+  CHECK(q.push(42, Duration::zero()) == Status::success);
+  CHECK(ws.wait(Duration::zero()) == Status::success);
+  CHECK(ws.isReady(q));
+  CHECK(!ws.isReady(sem));
+  uint32_t v = 0;
+  CHECK(q.pop(v, Duration::zero()) == Status::success);
+  CHECK(v == 42);
+
+  sem.unlock();
+  counter.unlock();
+  CHECK(ws.wait(Duration::zero()) == Status::success);
+  CHECK(ws.isReady(sem));
+  CHECK(sem.lock(Duration::zero()) == Status::success);
+  CHECK(ws.wait(Duration::zero()) == Status::success);
+  CHECK(ws.isReady(counter));
+  CHECK(counter.lock(Duration::zero()) == Status::success);
+  CHECK(ws.wait(Duration::zero()) != Status::success);
+
+  CHECK(ws.remove(counter) == Status::success);
+  CHECK(ws.size() == 2);
+}
+TEST_GROUP(JEL_TestGroup_Queues_Priority)
+{
+  static constexpr size_t Capacity = 16;
+  void setup()
+  {
+  }
+  void teardown()
+  {
+  }
+};
+TEST(JEL_TestGroup_Queues_Priority, UrgentElementOvertakesBacklog)
+{
+  PriorityQueue<uint32_t, Capacity> pq;
+  constexpr uint32_t telemetry = 1;
+  constexpr uint32_t urgent = 10;
+  for(uint32_t i = 0; i < Capacity - 1; i++)
+  {
+    CHECK(pq.push(i, telemetry, Duration::zero()) == Status::success);
+  }
+  CHECK(pq.push(1000, urgent, Duration::zero()) == Status::success);
+  CHECK(pq.push(0, urgent, Duration::milliseconds(2)) != Status::success);
+  uint32_t v;
+  uint32_t key;
+  CHECK(pq.pop(v, key, Duration::zero()) == Status::success);
+  CHECK(v == 1000);
+  CHECK(key == urgent);
+  //Equal priorities are popped in the order they were pushed.
+  for(uint32_t i = 0; i < Capacity - 1; i++)
+  {
+    CHECK(pq.pop(v, Duration::zero()) == Status::success);
+    CHECK(v == i);
+  }
+  CHECK(pq.pop(v, Duration::milliseconds(2)) != Status::success);
+}
+TEST(JEL_TestGroup_Queues_Priority, DeadlineOrdering)
+{
+  DeadlineQueue<std::unique_ptr<uint32_t>, Capacity> dq;
+  const Timestamp now = SteadyClock::now();
+  const uint32_t offsets_ms[] = {50, 10, 40, 20, 30};
+  for(auto ms : offsets_ms)
+  {
+    CHECK(dq.push(std::make_unique<uint32_t>(ms), now + Duration::milliseconds(ms),
+      Duration::zero()) == Status::success);
+  }
+  std::unique_ptr<uint32_t> v;
+  for(uint32_t expected = 10; expected <= 50; expected += 10)
+  {
+    CHECK(dq.pop(v, Duration::zero()) == Status::success);
+    CHECK(*v == expected);
+  }
+  CHECK(dq.empty());
+}
+TEST_GROUP(JEL_TestGroup_Queues_Spsc)
+{
+  static constexpr size_t Capacity = 16;
+  static constexpr size_t BenchmarkIterations = 1000;
+  struct ProducerArgs
+  {
+    SpscQueue<uint32_t, Capacity>* queue;
+    uint32_t count;
+  };
+  static void producerThread(void* args)
+  {
+    auto* pa = static_cast<ProducerArgs*>(args);
+    ThisThread::sleepfor(Duration::milliseconds(10));
+    for(uint32_t i = 0; i < pa->count; i++)
+    {
+      while(pa->queue->push(i) != Status::success)
+      {
+        ThisThread::yield();
+      }
+    }
+    while(true)
+    {
+      ThisThread::sleepfor(Duration::seconds(1));
+    }
+  }
+  void setup()
+  {
+  }
+  void teardown()
+  {
+  }
+};
+TEST(JEL_TestGroup_Queues_Spsc, OrderingAndWrap)
+{
+  SpscQueue<std::unique_ptr<uint32_t>, Capacity> q;
+  uint32_t next = 0;
+  uint32_t expected = 0;
+  //Several passes exercise wrapping of the ring indices.
+  for(size_t pass = 0; pass < 4; pass++)
+  {
+    while(q.size() < Capacity)
+    {
+      CHECK(q.push(std::make_unique<uint32_t>(next++)) == Status::success);
+    }
+    CHECK(q.push(std::make_unique<uint32_t>(next)) != Status::success);
+    for(size_t i = 0; i < Capacity / 2; i++)
+    {
+      std::unique_ptr<uint32_t> v;
+      CHECK(q.pop(v, Duration::zero()) == Status::success);
+      CHECK(*v == expected++);
+    }
+  }
+  std::unique_ptr<uint32_t> v;
+  while(q.pop(v, Duration::zero()) == Status::success)
+  {
+    CHECK(*v == expected++);
+  }
+  CHECK(expected == next);
+  CHECK(q.empty());
+}
+TEST(JEL_TestGroup_Queues_Spsc, BlockingPop)
+{
+  constexpr uint32_t count = 200;
+  SpscQueue<uint32_t, Capacity> q;
+  uint32_t v;
+  CHECK(q.pop(v, Duration::milliseconds(2)) != Status::success);
+  ProducerArgs args{&q, count};
+  Thread producer{&producerThread, &args, "spscProd", 256, Thread::Priority::low};
+  for(uint32_t i = 0; i < count; i++)
+  {
+    CHECK(q.pop(v, Duration::milliseconds(500)) == Status::success);
+    CHECK(v == i);
+  }
+  CHECK(q.pop(v, Duration::milliseconds(2)) != Status::success);
+}
+TEST(JEL_TestGroup_Queues_Spsc, ThroughputAgainstQueue)
+{
+  constexpr uint64_t cyclesPerUs = configCPU_CLOCK_HZ / 1'000'000;
+  Queue<uint32_t> rtosQueue{Capacity};
+  SpscQueue<uint32_t, Capacity> spscQueue;
+  uint32_t v = 0;
+  auto start = SteadyClock::now();
+  for(uint32_t i = 0; i < BenchmarkIterations; i++)
+  {
+    rtosQueue.push(i, Duration::zero());
+    rtosQueue.pop(v, Duration::zero());
+  }
+  Duration rtosTime = SteadyClock::now() - start;
+  start = SteadyClock::now();
+  for(uint32_t i = 0; i < BenchmarkIterations; i++)
+  {
+    spscQueue.push(i);
+    spscQueue.pop(v, Duration::zero());
+  }
+  Duration spscTime = SteadyClock::now() - start;
+  CHECK(v == BenchmarkIterations - 1);
+  UT_PRINT(StringFromFormat("push/pop x%u: Queue %lldus (~%llu cycles/pair), "
+    "SpscQueue %lldus (~%llu cycles/pair).", BenchmarkIterations, rtosTime.toMicroseconds(),
+    rtosTime.toMicroseconds() * cyclesPerUs / BenchmarkIterations, spscTime.toMicroseconds(),
+    spscTime.toMicroseconds() * cyclesPerUs / BenchmarkIterations).asCharString());
+  CHECK(spscTime < rtosTime);
+}
+TEST_GROUP(JEL_TestGroup_Queues_Mpmc)
+{
+  static constexpr size_t Capacity = 8;
+  static constexpr size_t WorkerCount = 2;
+  static constexpr uint32_t ItemsPerProducer = 500;
+  static constexpr size_t BenchmarkIterations = 1000;
+  using TestQueue = MpmcQueue<uint32_t, Capacity>;
+  struct WorkerArgs
+  {
+    TestQueue* queue;
+    std::atomic<uint32_t>* popped;
+    std::atomic<uint32_t>* sum;
+    std::atomic<uint32_t>* pushFailures;
+    CountingSemaphore* done;
+  };
+  static void parkForever()
+  {
+    while(true)
+    {
+      ThisThread::sleepfor(Duration::seconds(1));
+    }
+  }
+  static void producerThread(void* args)
+  {
+    auto* wa = static_cast<WorkerArgs*>(args);
+    for(uint32_t i = 0; i < ItemsPerProducer; i++)
+    {
+      if(wa->queue->push(i, Duration::milliseconds(500)) != Status::success)
+      {
+        wa->pushFailures->fetch_add(1);
+      }
+    }
+    wa->done->unlock();
+    parkForever();
+  }
+  static void consumerThread(void* args)
+  {
+    auto* wa = static_cast<WorkerArgs*>(args);
+    uint32_t v;
+    while(wa->queue->pop(v, Duration::milliseconds(100)) == Status::success)
+    {
+      wa->sum->fetch_add(v);
+      wa->popped->fetch_add(1);
+    }
+    wa->done->unlock();
+    parkForever();
+  }
+  void setup()
+  {
+  }
+  void teardown()
+  {
+  }
+};
+TEST(JEL_TestGroup_Queues_Mpmc, MultiProducerMultiConsumer)
+{
+  TestQueue q;
+  std::atomic<uint32_t> popped{0};
+  std::atomic<uint32_t> sum{0};
+  std::atomic<uint32_t> pushFailures{0};
+  CountingSemaphore done{WorkerCount * 2, 0};
+  WorkerArgs args{&q, &popped, &sum, &pushFailures, &done};
+  std::unique_ptr<Thread> workers[WorkerCount * 2];
+  for(size_t i = 0; i < WorkerCount; i++)
+  {
+    workers[i] = std::make_unique<Thread>(&producerThread, &args, "mpmcProd", 384,
+      Thread::Priority::low);
+    workers[WorkerCount + i] = std::make_unique<Thread>(&consumerThread, &args, "mpmcCons", 384,
+      Thread::Priority::low);
+  }
+  for(size_t i = 0; i < WorkerCount * 2; i++)
+  {
+    CHECK(done.lock(Duration::seconds(5)) == Status::success);
+  }
+  CHECK(pushFailures == 0);
+  CHECK(popped == WorkerCount * ItemsPerProducer);
+  CHECK(sum == WorkerCount * (ItemsPerProducer * (ItemsPerProducer - 1) / 2));
+  CHECK(q.empty());
+}
+TEST(JEL_TestGroup_Queues_Mpmc, ThroughputAgainstQueue)
+{
+  constexpr uint64_t cyclesPerUs = configCPU_CLOCK_HZ / 1'000'000;
+  Queue<uint32_t> rtosQueue{Capacity};
+  TestQueue mpmcQueue;
+  uint32_t v = 0;
+  auto start = SteadyClock::now();
+  for(uint32_t i = 0; i < BenchmarkIterations; i++)
+  {
+    rtosQueue.push(i, Duration::zero());
+    rtosQueue.pop(v, Duration::zero());
+  }
+  Duration rtosTime = SteadyClock::now() - start;
+  start = SteadyClock::now();
+  for(uint32_t i = 0; i < BenchmarkIterations; i++)
+  {
+    mpmcQueue.push(i, Duration::zero());
+    mpmcQueue.pop(v, Duration::zero());
+  }
+  Duration mpmcTime = SteadyClock::now() - start;
+  CHECK(v == BenchmarkIterations - 1);
+  UT_PRINT(StringFromFormat("push/pop x%u: Queue %lldus (~%llu cycles/pair), "
+    "MpmcQueue %lldus (~%llu cycles/pair).", BenchmarkIterations, rtosTime.toMicroseconds(),
+    rtosTime.toMicroseconds() * cyclesPerUs / BenchmarkIterations, mpmcTime.toMicroseconds(),
+    mpmcTime.toMicroseconds() * cyclesPerUs / BenchmarkIterations).asCharString());
+  CHECK(mpmcTime < rtosTime);
+}
+namespace
+{
+/** Counts lifetime events, so the number of constructions and moves per message is visible. */
+struct Tracked
+{
+  static size_t constructed;
+  static size_t moved;
+  static size_t destroyed;
+  std::unique_ptr<uint32_t> value;
+  explicit Tracked(uint32_t v) : value{std::make_unique<uint32_t>(v)} { constructed++; }
+  Tracked(Tracked&& other) noexcept : value{std::move(other.value)} { constructed++; moved++; }
+  Tracked& operator=(Tracked&& rhs) noexcept
+  {
+    value = std::move(rhs.value);
+    moved++;
+    return *this;
+  }
+  ~Tracked() noexcept { destroyed++; }
+};
+size_t Tracked::constructed;
+size_t Tracked::moved;
+size_t Tracked::destroyed;
+}
+TEST_GROUP(JEL_TestGroup_Queues_NonTrivial)
+{
+  void setup()
+  {
+    Tracked::constructed = 0;
+    Tracked::moved = 0;
+    Tracked::destroyed = 0;
+  }
+  void teardown()
+  {
+  }
+};
+TEST(JEL_TestGroup_Queues_NonTrivial, EmplaceAndConsumeWithoutMoves)
+{
+  Queue<Tracked> q{2};
+  CHECK(q.emplace(7u) == Status::success);
+  uint32_t seen = 0;
+  CHECK(q.consume([&](Tracked& t) { seen = *t.value; }, Duration::zero()) == Status::success);
+  CHECK(seen == 7);
+  CHECK(Tracked::constructed == 1);
+  CHECK(Tracked::moved == 0);
+  CHECK(Tracked::destroyed == 1);
+}
+TEST(JEL_TestGroup_Queues_NonTrivial, FailedPushKeepsItem)
+{
+  {
+    Queue<Tracked> q{1};
+    CHECK(q.emplaceFor(Duration::zero(), 1u) == Status::success);
+    Tracked t{2};
+    CHECK(q.push(std::move(t), Duration::zero()) != Status::success);
+    CHECK(t.value && (*t.value == 2));
+    CHECK(q.emplaceFor(Duration::zero(), 3u) != Status::success);
+  }
+  //Each constructed element, including the one left in the queue, must be destroyed exactly once.
+  CHECK(Tracked::destroyed == Tracked::constructed);
+}
 #endif
 } /** namespace jel */
@@ -0,0 +1,207 @@
+/** @file os/internal/slab.cpp
+ *  @brief Size class (slab) allocator implementation.
+ *
+ *  @detail
+ *
+ *  @author Jonathan Thomson 
+ */
+/**
+ * MIT License
+ * 
+ * Copyright 2018, Jonathan Thomson 
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** C/C++ Standard Library Headers */
+#include <cassert>
+/** jel Library Headers */
+#include "os/internal/slab.hpp"
+#include "os/api_common.hpp"
+#include "os/api_time.hpp"
+
+namespace jel
+{
+
+size_t SlabAllocator::storageRequired_Bytes(const config::SlabClassConfiguration* classes,
+  size_t count) noexcept
+{
+  size_t total = 0;
+  if(count > maxClasses) { count = maxClasses; }
+  for(size_t i = 0; i < count; i++)
+  {
+    total += classes[i].blockSize_Bytes * classes[i].totalBlocks;
+  }
+  return total;
+}
+
+SlabAllocator::SlabAllocator(const config::SlabClassConfiguration* classes, size_t count,
+  void* storage) noexcept : count_{count > maxClasses ? maxClasses : count}
+{
+  //Each class occupies a contiguous slice of the storage, in the order given. This allows the class
+  //of a block to be found from its address alone.
+  uint8_t* mem = static_cast<uint8_t*>(storage);
+  begin_ = mem;
+  for(size_t i = 0; i < count_; i++)
+  {
+    SizeClass& sc = classes_[i];
+    const size_t bsz = classes[i].blockSize_Bytes;
+    assert(bsz >= sizeof(FreeBlock) && (bsz % 8) == 0);
+    assert(i == 0 || bsz > classes[i - 1].blockSize_Bytes);
+    sc.stats = ClassStatistics{bsz, classes[i].totalBlocks, 0, 0, 0, 0};
+    sc.begin = mem;
+    sc.freeList = nullptr;
+    //Thread the free list in reverse so blocks are handed out in address order.
+    for(size_t b = classes[i].totalBlocks; b > 0; b--)
+    {
+      FreeBlock* fb = reinterpret_cast<FreeBlock*>(mem + (b - 1) * bsz);
+      fb->next = sc.freeList;
+      sc.freeList = fb;
+    }
+    mem += bsz * classes[i].totalBlocks;
+    sc.end = mem;
+  }
+  end_ = mem;
+}
+
+void* SlabAllocator::allocate(const size_t size) noexcept
+{
+  for(size_t i = 0; i < count_; i++)
+  {
+    SizeClass& sc = classes_[i];
+    if(size <= sc.stats.blockSize_Bytes)
+    {
+      FreeBlock* fb = sc.freeList;
+      if(fb == nullptr)
+      {
+        sc.stats.misses++;
+        return nullptr;
+      }
+      sc.freeList = fb->next;
+      sc.stats.hits++;
+      if(++sc.stats.inUse > sc.stats.highWater) { sc.stats.highWater = sc.stats.inUse; }
+      return fb;
+    }
+  }
+  return nullptr;
+}
+
+void SlabAllocator::deallocate(void* ptr) noexcept
+{
+  SizeClass& sc = const_cast<SizeClass&>(classOf(ptr));
+  assert(((static_cast<const uint8_t*>(ptr) - sc.begin) % sc.stats.blockSize_Bytes) == 0);
+  FreeBlock* fb = static_cast<FreeBlock*>(ptr);
+  fb->next = sc.freeList;
+  sc.freeList = fb;
+  sc.stats.inUse--;
+}
+
+const SlabAllocator::SizeClass& SlabAllocator::classOf(const void* ptr) const noexcept
+{
+  assert(owns(ptr));
+  size_t i = 0;
+  while(i + 1 < count_ && ptr >= classes_[i].end)
+  {
+    i++;
+  }
+  return classes_[i];
+}
+
+#ifdef TARGET_SUPPORTS_CPPUTEST
+TEST_GROUP(JEL_TestGroup_SlabAllocator)
+{
+  static constexpr config::SlabClassConfiguration testClasses[] = { {16, 8}, {32, 4} };
+  static constexpr size_t testClassCount = sizeof(testClasses) / sizeof(testClasses[0]);
+  uint64_t* storage;
+  SlabAllocator* slab;
+  void setup()
+  {
+    size_t sz = SlabAllocator::storageRequired_Bytes(testClasses, testClassCount);
+    storage = new uint64_t[sz / sizeof(uint64_t)];
+    slab = new SlabAllocator(testClasses, testClassCount, storage);
+  }
+  void teardown()
+  {
+    delete slab;
+    delete[] storage;
+  }
+};
+TEST(JEL_TestGroup_SlabAllocator, ClassSelectionAndStatistics)
+{
+  CHECK(slab->classCount() == 2);
+  void* small = slab->allocate(1);
+  void* mid = slab->allocate(17);
+  CHECK(small && mid);
+  CHECK(slab->owns(small) && slab->owns(mid));
+  CHECK(slab->usableSize(small) == 16);
+  CHECK(slab->usableSize(mid) == 32);
+  CHECK(slab->allocate(33) == nullptr);
+  CHECK(slab->classStatistics(0).hits == 1);
+  CHECK(slab->classStatistics(1).hits == 1);
+  slab->deallocate(small);
+  slab->deallocate(mid);
+  CHECK(slab->classStatistics(0).inUse == 0);
+  CHECK(slab->classStatistics(0).highWater == 1);
+  int onStack;
+  CHECK(!slab->owns(&onStack));
+}
+TEST(JEL_TestGroup_SlabAllocator, ExhaustionFallsThrough)
+{
+  void* ptrs[4];
+  for(auto& p : ptrs)
+  {
+    p = slab->allocate(32);
+    CHECK(p);
+  }
+  //A full class reports a miss rather than borrowing from another class.
+  CHECK(slab->allocate(32) == nullptr);
+  CHECK(slab->classStatistics(1).misses == 1);
+  CHECK(slab->classStatistics(0).inUse == 0);
+  for(auto& p : ptrs)
+  {
+    slab->deallocate(p);
+  }
+  CHECK(slab->classStatistics(1).highWater == 4);
+  CHECK(slab->allocate(32) == ptrs[3]);
+}
+TEST(JEL_TestGroup_SlabAllocator, SystemAllocatorLatency)
+{
+  //Small allocations through the system allocator should be served by the slab front-end when it
+  //is enabled, and be no slower than the same number of heap allocations.
+  constexpr size_t iterations = 500;
+  Timestamp start = SteadyClock::now();
+  for(size_t i = 0; i < iterations; i++)
+  {
+    delete new uint32_t{0};
+  }
+  Duration smallTime = SteadyClock::now() - start;
+  start = SteadyClock::now();
+  for(size_t i = 0; i < iterations; i++)
+  {
+    delete[] new uint8_t[config::systemSlabClasses[0].blockSize_Bytes * 16];
+  }
+  Duration heapTime = SteadyClock::now() - start;
+  UT_PRINT(StringFromFormat("%u new/delete pairs: %lldus small (slab), %lldus large (heap).",
+    iterations, smallTime.toMicroseconds(), heapTime.toMicroseconds()).asCharString());
+  if(config::useSystemSlab)
+  {
+    CHECK(smallTime <= heapTime);
+  }
+}
+#endif
+
+} /** namespace jel */
@@ -0,0 +1,116 @@
+/** @file os/internal/slab.hpp
+ *  @brief A size class (slab) allocator used as a front-end to the system heap.
+ *
+ *  @detail
+ *    The SlabAllocator divides one contiguous memory region into a small number of size classes,
+ *    each a pool of equally sized blocks threaded onto an intrusive free list. Allocation pops the
+ *    head of the first class large enough for the request and deallocation pushes the block back,
+ *    so both are O(1) and carry no per-block header. The SystemAllocator places a SlabAllocator in
+ *    front of the system heap so that the many small, short lived objects created by jel (CLI
+ *    arguments, shared_ptr control blocks, short strings and the like) never fragment the heap.
+ *
+ *    The SlabAllocator is *not* threadsafe. Users (i.e. the SystemAllocator) are responsible for
+ *    locking.
+ *    This header should not be included by any application files, only jel os files.
+ *
+ *  @author Jonathan Thomson
+ */
+/**
+ * MIT License
+ *
+ * Copyright 2018, Jonathan Thomson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+/** C/C++ Standard Library Headers */
+#include <cstdint>
+#include <cstddef>
+/** jel Library Headers */
+#include "os/api_config.hpp"
+
+namespace jel
+{
+
+class SlabAllocator
+{
+public:
+  /** The maximum number of size classes a single SlabAllocator supports. */
+  static constexpr size_t maxClasses = 8;
+  /** @struct ClassStatistics
+   *  @brief Usage statistics for a single size class. */
+  struct ClassStatistics
+  {
+    size_t blockSize_Bytes;
+    size_t totalBlocks;
+    /** Blocks currently allocated. */
+    size_t inUse;
+    /** Most blocks ever allocated at once. */
+    size_t highWater;
+    /** Requests that were served by this class. */
+    size_t hits;
+    /** Requests that mapped to this class but fell through because it was exhausted. */
+    size_t misses;
+  };
+  /** Returns the number of bytes of storage required for the given class configuration. */
+  static size_t storageRequired_Bytes(const config::SlabClassConfiguration* classes,
+    size_t count) noexcept;
+  /** Construct a slab allocator using storage, which must be at least storageRequired_Bytes() in
+   * size and 8 byte aligned. Classes beyond maxClasses are ignored. */
+  SlabAllocator(const config::SlabClassConfiguration* classes, size_t count,
+    void* storage) noexcept;
+  SlabAllocator(const SlabAllocator&) = delete;
+  SlabAllocator& operator=(const SlabAllocator&) = delete;
+  /** Returns a block from the smallest class that fits size, or a nullptr if size is larger than
+   * every class or the matching class has no free blocks. Larger classes are not used as a
+   * fallback, to keep them available for the requests they are sized for. */
+  void* allocate(size_t size) noexcept;
+  /** Returns true if ptr was allocated by this slab allocator. */
+  bool owns(const void* ptr) const noexcept { return ptr >= begin_ && ptr < end_; }
+  /** Returns a block to its class. ptr must satisfy owns(). */
+  void deallocate(void* ptr) noexcept;
+  /** Returns the block size of the class holding ptr. ptr must satisfy owns(). */
+  size_t usableSize(const void* ptr) const noexcept { return classOf(ptr).stats.blockSize_Bytes; }
+  size_t classCount() const noexcept { return count_; }
+  const ClassStatistics& classStatistics(size_t index) const noexcept
+  {
+    return classes_[index].stats;
+  }
+private:
+  struct FreeBlock
+  {
+    FreeBlock* next;
+  };
+  struct SizeClass
+  {
+    FreeBlock* freeList;
+    const uint8_t* begin;
+    const uint8_t* end;
+    ClassStatistics stats;
+  };
+  SizeClass classes_[maxClasses];
+  size_t count_;
+  const void* begin_;
+  const void* end_;
+  const SizeClass& classOf(const void* ptr) const noexcept;
+};
+
+/** Returns the slab front-end used by the SystemAllocator, or a nullptr if it is disabled. */
+const SlabAllocator* systemSlabAllocator() noexcept;
+
+} /** namespace jel */
@@ -30,72 +30,14 @@
 #include <cassert>
 /** jel Library Headers */
 #include "os/api_system.hpp"
+#include "os/api_locks.hpp"
+#include "os/api_queues.hpp"
 #include "os/api_threads.hpp"
 #include "os/internal/indef.hpp"
 
 namespace jel
 {
 
-bool System::cpuExceptionActive() noexcept
-{
-#if defined(HW_TARGET_RM57L843)
-  return false; /**< TODO */
-#elif defined(HW_TARGET_TM4C123GH6PM) 
-  uint32_t* scb_icsr = reinterpret_cast<uint32_t*>(0xE000ED04);
-  if((*scb_icsr & 0x1FF) != 0)
-  {
-    return true;
-  }
-#elif defined(HW_TARGET_TM4C1294NCPDT)
-  uint32_t* scb_icsr = reinterpret_cast<uint32_t*>(0xE000ED04);
-  if((*scb_icsr & 0x1FF) != 0)
-  {
-    return true;
-  }
-#elif defined(HW_TARGET_STM32F302RCT6)
-  uint32_t* scb_icsr = reinterpret_cast<uint32_t*>(0xE000ED04);
-  if((*scb_icsr & 0x1FF) != 0)
-  {
-    return true;
-  }
-#else
-#ifndef __clang__
-#error "CPU architecture not supported."
-#endif
-#endif
-  return false;
-}
-
-bool System::inIsr() noexcept
-{
-#if defined(HW_TARGET_RM57L843)
-  return true; /**< TODO */
-#elif defined(HW_TARGET_TM4C123GH6PM) || defined(HW_TARGET_TM4C129XNCZAD)
-  uint32_t* scb_icsr = reinterpret_cast<uint32_t*>(0xE000ED04);
-  if((*scb_icsr & 0x1FF) != 0)
-  {
-    return true;
-  }
-#elif defined(HW_TARGET_TM4C1294NCPDT)
-  uint32_t* scb_icsr = reinterpret_cast<uint32_t*>(0xE000ED04);
-  if((*scb_icsr & 0x1FF) != 0)
-  {
-    return true;
-  }
-#elif defined(HW_TARGET_STM32F302RCT6)
-  uint32_t* scb_icsr = reinterpret_cast<uint32_t*>(0xE000ED04);
-  if((*scb_icsr & 0x1FF) != 0)
-  {
-    return true;
-  }
-#else
-#ifndef __clang__
-#error "CPU architecture not supported."
-#endif
-#endif
-  return false;
-}
-
 CriticalSection::CriticalSection() noexcept
 {
   if(System::cpuExceptionActive())
@@ -133,5 +75,156 @@ SchedulerLock::~SchedulerLock() noexcept
   }
 }
 
+InterruptMaskMonitor::InterruptMaskMonitor(const char* name) noexcept :
+  name_{name}, longest_{0}, entries_{0}
+{
+#if defined(HW_TARGET_RM57L843)
+  //Enable the PMU (PMCR.E) and its cycle counter (PMCNTENSET.C).
+  uint32_t pmcr;
+  __asm volatile("mrc p15, 0, %0, c9, c12, 0" : "=r"(pmcr));
+  __asm volatile("mcr p15, 0, %0, c9, c12, 0" :: "r"(pmcr | 0x1));
+  __asm volatile("mcr p15, 0, %0, c9, c12, 1" :: "r"(0x8000'0000));
+#elif defined(HW_TARGET_TM4C123GH6PM) || defined(HW_TARGET_TM4C129XNCZAD) || \
+  defined(HW_TARGET_TM4C1294NCPDT) || defined(HW_TARGET_STM32F302RCT6)
+  //Enable the trace block (DEMCR.TRCENA), then the DWT cycle counter (DWT_CTRL.CYCCNTENA).
+  *reinterpret_cast<volatile uint32_t*>(0xE000EDFC) |= 0x0100'0000;
+  *reinterpret_cast<volatile uint32_t*>(0xE0001000) |= 0x1;
+#endif
+}
+
+#ifdef TARGET_SUPPORTS_CPPUTEST
+TEST_GROUP(JEL_TestGroup_System)
+{
+  static constexpr size_t BenchmarkIterations = 1000;
+  /** The previous, out of line context check, kept as a baseline for the benchmark. */
+  static bool __attribute__((noinline)) legacyInIsr() noexcept
+  {
+#if defined(HW_TARGET_RM57L843)
+    return true;
+#else
+    return (*reinterpret_cast<volatile uint32_t*>(0xE000ED04) & 0x1FF) != 0;
+#endif
+  }
+  void setup()
+  {
+  }
+  void teardown()
+  {
+  }
+};
+TEST(JEL_TestGroup_System, ThreadContext)
+{
+  CHECK(System::inIsr() == false);
+  CHECK(System::cpuExceptionActive() == false);
+}
+TEST(JEL_TestGroup_System, ContextCheckThroughput)
+{
+  constexpr uint64_t cyclesPerUs = configCPU_CLOCK_HZ / 1'000'000;
+  volatile uint32_t sink = 0;
+  auto start = SteadyClock::now();
+  for(size_t i = 0; i < BenchmarkIterations; i++)
+  {
+    sink = sink + legacyInIsr();
+  }
+  Duration legacyTime = SteadyClock::now() - start;
+  start = SteadyClock::now();
+  for(size_t i = 0; i < BenchmarkIterations; i++)
+  {
+    sink = sink + System::inIsr();
+  }
+  Duration inlineTime = SteadyClock::now() - start;
+  //Each queue and lock operation below performs one context check.
+  Queue<uint32_t> q{1};
+  uint32_t item = 0;
+  start = SteadyClock::now();
+  for(size_t i = 0; i < BenchmarkIterations; i++)
+  {
+    q.push(item, Duration::zero());
+    q.pop(item, Duration::zero());
+  }
+  Duration queueTime = SteadyClock::now() - start;
+  Semaphore sem;
+  start = SteadyClock::now();
+  for(size_t i = 0; i < BenchmarkIterations; i++)
+  {
+    sem.lock(Duration::zero());
+    sem.unlock();
+  }
+  Duration lockTime = SteadyClock::now() - start;
+  UT_PRINT(StringFromFormat("context check x%u: out of line %lldus (~%llu cycles), inline %lldus "
+    "(~%llu cycles). Queue push/pop ~%llu cycles/pair, Semaphore lock/unlock ~%llu cycles/pair.",
+    BenchmarkIterations, legacyTime.toMicroseconds(),
+    legacyTime.toMicroseconds() * cyclesPerUs / BenchmarkIterations, inlineTime.toMicroseconds(),
+    inlineTime.toMicroseconds() * cyclesPerUs / BenchmarkIterations,
+    queueTime.toMicroseconds() * cyclesPerUs / BenchmarkIterations,
+    lockTime.toMicroseconds() * cyclesPerUs / BenchmarkIterations).asCharString());
+  CHECK(inlineTime <= legacyTime);
+}
+TEST_GROUP(JEL_TestGroup_InterruptMaskGuard)
+{
+  /** The RTOS tick runs at the lowest interrupt priority, so a guard at this threshold masks it.
+   * innerThreshold is a second, different threshold used to nest a guard within it. */
+#if defined(HW_TARGET_RM57L843)
+  static constexpr uint32_t tickThreshold = 2;
+  static constexpr uint32_t innerThreshold = tickThreshold + 1;
+#else
+#if defined(HW_TARGET_STM32F302RCT6)
+  static constexpr uint32_t priorityBits = configPRIO_BITS;
+#else
+  static constexpr uint32_t priorityBits = 3;
+#endif
+  static constexpr uint32_t tickThreshold = configKERNEL_INTERRUPT_PRIORITY >> (8 - priorityBits);
+  static constexpr uint32_t innerThreshold = tickThreshold - 1;
+#endif
+  static constexpr uint32_t maskedTicks = 5;
+  static constexpr uint32_t cyclesPerTick = configCPU_CLOCK_HZ / configTICK_RATE_HZ;
+  static void spin(const uint32_t cycles)
+  {
+    const uint32_t start = InterruptMaskMonitor::cycleCount();
+    while(InterruptMaskMonitor::cycleCount() - start < cycles);
+  }
+  void setup()
+  {
+  }
+  void teardown()
+  {
+  }
+};
+TEST(JEL_TestGroup_InterruptMaskGuard, MasksTickAndRecordsInterval)
+{
+  InterruptMaskMonitor monitor{"test"};
+  const TickType_t before = xTaskGetTickCount();
+  {
+    InterruptMaskGuard<tickThreshold> guard{&monitor};
+    spin(cyclesPerTick * maskedTicks);
+  }
+  //Ticks raised while masked latch a single pending interrupt, which runs once the guard exits.
+  CHECK(xTaskGetTickCount() - before <= 1);
+  CHECK(monitor.entries() == 1);
+  CHECK(monitor.longestInterval_cycles() >= cyclesPerTick * maskedTicks);
+  {
+    InterruptMaskGuard<tickThreshold> guard{&monitor};
+  }
+  CHECK(monitor.entries() == 2);
+  CHECK(monitor.longestInterval_cycles() >= cyclesPerTick * maskedTicks);
+  monitor.reset();
+  CHECK(monitor.entries() == 0);
+  CHECK(monitor.longestInterval_cycles() == 0);
+}
+TEST(JEL_TestGroup_InterruptMaskGuard, NestedGuardKeepsOuterMask)
+{
+  const TickType_t before = xTaskGetTickCount();
+  {
+    InterruptMaskGuard<tickThreshold> outer;
+    {
+      InterruptMaskGuard<innerThreshold> inner;
+    }
+    //Leaving the inner guard must restore the outer mask, not unmask every interrupt.
+    spin(cyclesPerTick * maskedTicks);
+  }
+  CHECK(xTaskGetTickCount() - before <= 1);
+}
+#endif
+
 } /** namespace jel */
 
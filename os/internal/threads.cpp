@@ -52,6 +52,8 @@ GenericThread_Base::GenericThread_Base()
 
 void GenericThread_Base::startThread(Thread* threadObject) 
 {
+  static_assert(sizeof(ThreadControlStructureMemory) >= sizeof(StaticTask_t),
+    "ThreadControlStructureMemory is too small for the RTOS task control block.");
   Thread::ThreadInfo* inf = threadObject->inf_.get();
   inf->handle_ = nullptr;
   if(inf->cbMem_ && inf->stackMem_)
@@ -73,6 +75,7 @@ void GenericThread_Base::startThread(Thread* threadObject)
     }
 #ifdef ENABLE_THREAD_STATISTICS
     Thread::ireg_->push_back(inf);
+    Thread::bindThreadInfo(inf->handle_, inf);
 #endif
     vTaskPrioritySet(inf->handle_, static_cast<uint32_t>(inf->priority_));
   }
@@ -125,11 +128,18 @@ void GenericThread_Base::dispatcher(void* threadInf)
   if(inf->isDetached_)
   {
 #ifdef ENABLE_THREAD_STATISTICS
-    for(auto it = Thread::ireg_->begin(); it != Thread::ireg_->end(); it++)
     {
-      if((*it)->handle_ == inf->handle_)
+      //The scheduler is locked so the switch hooks can never see the ThreadInfo after it has been
+      //unbound from the task but before it is deleted.
+      SchedulerLock schLock;
+      Thread::bindThreadInfo(inf->handle_, nullptr);
+      for(auto it = Thread::ireg_->begin(); it != Thread::ireg_->end(); it++)
       {
-        Thread::ireg_->erase(it);
+        if((*it)->handle_ == inf->handle_)
+        {
+          Thread::ireg_->erase(it);
+          break;
+        }
       }
     }
 #endif
@@ -167,11 +177,16 @@ Thread::~Thread() noexcept
   if(inf_ != nullptr)
   {
 #ifdef ENABLE_THREAD_STATISTICS
+    if(inf_->handle_ != nullptr)
+    {
+      bindThreadInfo(inf_->handle_, nullptr);
+    }
     for(auto it = Thread::ireg_->begin(); it != Thread::ireg_->end(); it++)
     {
       if((*it)->handle_ == inf_->handle_)
       {
         Thread::ireg_->erase(it);
+        break;
       }
     }
 #endif
@@ -186,41 +201,63 @@ Thread::~Thread() noexcept
 #ifdef ENABLE_THREAD_STATISTICS
 void Thread::schedulerEntry(Handle handle)
 {
-  for(ThreadInfo* it : *ireg_)
+  //Called on every context switch. The ThreadInfo is read directly from the task's thread local
+  //storage slot, so the cost of this hook does not depend on the number of registered threads.
+  ThreadInfo* inf = boundThreadInfo(handle);
+  if(inf != nullptr)
   {
-    if(it->handle_ == handle)
-    {
-      it->lastEntry_ = SteadyClock::now();
-      break;
-    }
+    inf->lastEntry_ = SteadyClock::now();
   }
 }
 
 void Thread::schedulerExit(Handle handle)
 {
+  ThreadInfo* inf = boundThreadInfo(handle);
+  if(inf != nullptr)
+  {
+    inf->totalRuntime_ += SteadyClock::now() - inf->lastEntry_;
+  }
+}
+
+void Thread::schedulerThreadCreation(Handle handle)
+{
+  //Threads created through the Thread wrapper are bound once xTaskCreate returns. Kernel created
+  //threads (i.e. the idle task) register their ThreadInfo before they exist and so are bound here
+  //instead. This is only called on thread creation, so the registry search is acceptable.
+  if(ireg_ == nullptr)
+  {
+    return;
+  }
   for(ThreadInfo* it : *ireg_)
   {
     if(it->handle_ == handle)
     {
-      it->totalRuntime_ += SteadyClock::now() - it->lastEntry_;
+      bindThreadInfo(handle, it);
       break;
     }
   }
 }
 
-void Thread::schedulerThreadCreation(Handle)
-{
-}
-
 void Thread::schedulerAddIdleTask(Handle h, ThreadInfo* inf)
 {
-  (void)h; //Handle no longer used after refactoring from std::map to vector.
+  (void)h; //The idle task is bound to its ThreadInfo on creation, see schedulerThreadCreation().
   if(ireg_ == nullptr)
   {
     ireg_ = std::make_unique<InfoRegistry>();
   }
   ireg_->push_back(inf);
 }
+
+void Thread::bindThreadInfo(Handle handle, ThreadInfo* info) noexcept
+{
+  vTaskSetThreadLocalStoragePointer(handle, jelTHREAD_INFO_TLS_INDEX, info);
+}
+
+Thread::ThreadInfo* Thread::boundThreadInfo(Handle handle) noexcept
+{
+  return static_cast<ThreadInfo*>(pvTaskGetThreadLocalStoragePointer(handle, 
+    jelTHREAD_INFO_TLS_INDEX));
+}
 #endif
 
 const char* Thread::lookupName(const Handle& handle)
@@ -246,8 +283,13 @@ void ThisThread::yield() noexcept
 
 void ThisThread::deleteSelf(bool performCompleteErasure) noexcept
 {
+#ifdef ENABLE_THREAD_STATISTICS
   if(performCompleteErasure)
   {
+    //The ThreadInfo must not be freed while it is still bound to this task, or the switch out hook
+    //would write to released memory before vTaskDelete() completes.
+    SchedulerLock schLock;
+    Thread::bindThreadInfo(xTaskGetCurrentTaskHandle(), nullptr);
     for(auto it = Thread::ireg_->begin(); it != Thread::ireg_->end(); it++)
     {
       if((*it)->handle_ == xTaskGetCurrentTaskHandle())
@@ -260,16 +302,16 @@ void ThisThread::deleteSelf(bool performCompleteErasure) noexcept
   }
   else
   {
-    for(auto&& it : *Thread::ireg_)
+    Thread::ThreadInfo* inf = Thread::boundThreadInfo(xTaskGetCurrentTaskHandle());
+    if(inf != nullptr)
     {
-      if(it->handle_ == xTaskGetCurrentTaskHandle())
-      {
-        it->isDeleted_ = true;
-        it->minStackBeforeDeletion_bytes_ = uxTaskGetStackHighWaterMark(nullptr) * 4;
-        break;
-      }
+      inf->isDeleted_ = true;
+      inf->minStackBeforeDeletion_bytes_ = uxTaskGetStackHighWaterMark(nullptr) * 4;
     }
   }
+#else
+  (void)performCompleteErasure;
+#endif
   vTaskDelete(nullptr);
 }
 
@@ -291,5 +333,58 @@ void* ThisThread::handle()
   return xTaskGetCurrentTaskHandle(); 
 }
 
+#if defined(TARGET_SUPPORTS_CPPUTEST) && defined(ENABLE_THREAD_STATISTICS)
+TEST_GROUP(JEL_TestGroup_Threads)
+{
+  static constexpr size_t hookIterations = 2000;
+  static constexpr size_t extraThreadCount = 24;
+  static void sleepingThread(void*)
+  {
+    while(true)
+    {
+      ThisThread::sleepfor(Duration::seconds(1));
+    }
+  }
+  /** Runs the context switch hooks against the calling thread. The scheduler is locked so that no
+   * real context switches are included in the measurement. */
+  Duration timeSchedulerHooks()
+  {
+    Thread::Handle h = ThisThread::handle();
+    SchedulerLock schLock;
+    Timestamp start = SteadyClock::now();
+    for(size_t i = 0; i < hookIterations; i++)
+    {
+      Thread::schedulerExit(h);
+      Thread::schedulerEntry(h);
+    }
+    return SteadyClock::now() - start;
+  }
+  void setup()
+  {
+  }
+  void teardown()
+  {
+  }
+};
+TEST(JEL_TestGroup_Threads, SchedulerHookCostIsIndependentOfThreadCount)
+{
+  Duration baseline = timeSchedulerHooks();
+  std::unique_ptr<Thread> extraThreads[extraThreadCount];
+  for(size_t i = 0; i < extraThreadCount; i++)
+  {
+    extraThreads[i] = std::make_unique<Thread>(&sleepingThread, nullptr, "hookBench", 256,
+      Thread::Priority::low);
+  }
+  Duration loaded = timeSchedulerHooks();
+  UT_PRINT(StringFromFormat("Switch hook cost (%u entry/exit pairs): %lldus with %u threads, "
+    "%lldus with %u threads.", hookIterations, baseline.toMicroseconds(),
+    Thread::registry().size() - extraThreadCount, loaded.toMicroseconds(),
+    Thread::registry().size()).asCharString());
+  //Allow some margin for timer resolution and interrupts. A registry search would instead scale
+  //with the number of threads.
+  CHECK(loaded <= (baseline + baseline / 4 + Duration::microseconds(50)));
+}
+#endif
+
 }
 /** namespace jel */
@@ -0,0 +1,416 @@
+/** @file os/internal/tlsf.cpp
+ *  @brief Two-Level Segregated Fit heap implementation.
+ *
+ *  @detail
+ *
+ *  @author Jonathan Thomson 
+ */
+/**
+ * MIT License
+ * 
+ * Copyright 2018, Jonathan Thomson 
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** C/C++ Standard Library Headers */
+#include <cstring>
+#include <cassert>
+/** jel Library Headers */
+#include "os/internal/tlsf.hpp"
+#include "os/api_common.hpp"
+#include "os/api_time.hpp"
+
+namespace jel
+{
+
+TlsfHeap::TlsfHeap(void* pool, size_t size) noexcept : flBitmap_{0}, slBitmap_{}, freeLists_{},
+  poolSize_{0}, freeBytes_{0}, minFreeBytes_{0}
+{
+  //Align the start of the region, then round the size down so the final (sentinel) header is
+  //also aligned.
+  uintptr_t start = reinterpret_cast<uintptr_t>(pool);
+  uintptr_t alignedStart = (start + alignment_Bytes - 1) & ~(alignment_Bytes - 1);
+  if(size < (alignedStart - start) + 2 * headerSize_Bytes + minimumBlockSize_Bytes)
+  {
+    return;
+  }
+  size -= alignedStart - start;
+  if(size > maxPoolSize_Bytes) { size = maxPoolSize_Bytes; }
+  size &= ~(alignment_Bytes - 1);
+  poolSize_ = size;
+  //The pool begins as a single free block followed by a zero sized sentinel block that is always
+  //marked as in use. The sentinel terminates physical traversal and prevents coalescing past the
+  //end of the region.
+  Block* first = reinterpret_cast<Block*>(alignedStart);
+  first->prevPhys = nullptr;
+  first->sizeAndFlags = 0;
+  first->setSize(size - 2 * headerSize_Bytes);
+  Block* sentinel = first->nextPhys();
+  sentinel->prevPhys = first;
+  sentinel->sizeAndFlags = 0;
+  sentinel->setPrevFree(true);
+  first->setFree(true);
+  insertFreeBlock(first);
+  minFreeBytes_ = freeBytes_;
+}
+
+void TlsfHeap::mapInsert(const size_t size, size_t& fl, size_t& sl) noexcept
+{
+  if(size < smallBlockSize_Bytes)
+  {
+    fl = 0;
+    sl = size / (smallBlockSize_Bytes / slCount);
+  }
+  else
+  {
+    size_t msb = findLastSet(size);
+    sl = (size >> (msb - slIndexCountLog2)) ^ (1 << slIndexCountLog2);
+    fl = msb - (flIndexShift - 1);
+  }
+}
+
+void TlsfHeap::mapSearch(size_t size, size_t& fl, size_t& sl) noexcept
+{
+  //Round the request up to the next list boundary so any block in the selected list is large
+  //enough. This is what makes the search 'good fit' rather than 'best fit', but avoids walking a
+  //list.
+  if(size >= smallBlockSize_Bytes)
+  {
+    size += (static_cast<size_t>(1) << (findLastSet(size) - slIndexCountLog2)) - 1;
+  }
+  mapInsert(size, fl, sl);
+}
+
+TlsfHeap::Block* TlsfHeap::blockFromPayload(const void* ptr) noexcept
+{
+  return reinterpret_cast<Block*>(
+    const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(ptr)) - headerSize_Bytes);
+}
+
+size_t TlsfHeap::adjustRequest(size_t size) noexcept
+{
+  size = (size + alignment_Bytes - 1) & ~(alignment_Bytes - 1);
+  return size < minimumBlockSize_Bytes ? minimumBlockSize_Bytes : size;
+}
+
+TlsfHeap::Block* TlsfHeap::findSuitableBlock(size_t& fl, size_t& sl) noexcept
+{
+  //First look for a non-empty list in the same first level class, then fall back to the smallest
+  //non-empty larger first level class.
+  uint32_t slMap = slBitmap_[fl] & (~static_cast<uint32_t>(0) << sl);
+  if(slMap == 0)
+  {
+    uint32_t flMap = (fl + 1 < 32) ? flBitmap_ & (~static_cast<uint32_t>(0) << (fl + 1)) : 0;
+    if(flMap == 0)
+    {
+      return nullptr;
+    }
+    fl = findFirstSet(flMap);
+    slMap = slBitmap_[fl];
+  }
+  sl = findFirstSet(slMap);
+  return freeLists_[fl][sl];
+}
+
+void TlsfHeap::insertFreeBlock(Block* block) noexcept
+{
+  size_t fl, sl;
+  mapInsert(block->size(), fl, sl);
+  Block* head = freeLists_[fl][sl];
+  block->nextFree = head;
+  block->prevFree = nullptr;
+  if(head != nullptr) { head->prevFree = block; }
+  freeLists_[fl][sl] = block;
+  flBitmap_ |= (1u << fl);
+  slBitmap_[fl] |= (1u << sl);
+  freeBytes_ += block->size();
+}
+
+void TlsfHeap::removeFreeBlock(Block* block) noexcept
+{
+  size_t fl, sl;
+  mapInsert(block->size(), fl, sl);
+  if(block->prevFree != nullptr) { block->prevFree->nextFree = block->nextFree; }
+  if(block->nextFree != nullptr) { block->nextFree->prevFree = block->prevFree; }
+  if(freeLists_[fl][sl] == block)
+  {
+    freeLists_[fl][sl] = block->nextFree;
+    if(block->nextFree == nullptr)
+    {
+      slBitmap_[fl] &= ~(1u << sl);
+      if(slBitmap_[fl] == 0) { flBitmap_ &= ~(1u << fl); }
+    }
+  }
+  freeBytes_ -= block->size();
+}
+
+void TlsfHeap::trimUsedBlock(Block* block, const size_t size) noexcept
+{
+  if(block->size() < size + headerSize_Bytes + minimumBlockSize_Bytes)
+  {
+    //The remainder is too small to hold a free block; leave it as internal fragmentation.
+    return;
+  }
+  Block* next = block->nextPhys();
+  Block* remainder = reinterpret_cast<Block*>(reinterpret_cast<uint8_t*>(block->payload()) + size);
+  remainder->prevPhys = block;
+  remainder->sizeAndFlags = 0;
+  remainder->setSize(block->size() - size - headerSize_Bytes);
+  block->setSize(size);
+  //Coalesce the remainder with a free successor immediately, so no two free blocks are ever
+  //physically adjacent.
+  if(next->isFree())
+  {
+    removeFreeBlock(next);
+    remainder->setSize(remainder->size() + headerSize_Bytes + next->size());
+    next = remainder->nextPhys();
+  }
+  next->prevPhys = remainder;
+  next->setPrevFree(true);
+  remainder->setFree(true);
+  insertFreeBlock(remainder);
+}
+
+void* TlsfHeap::allocate(size_t size) noexcept
+{
+  if(size == 0 || size > maxPoolSize_Bytes)
+  {
+    return nullptr;
+  }
+  size = adjustRequest(size);
+  size_t fl, sl;
+  mapSearch(size, fl, sl);
+  if(fl >= flCount)
+  {
+    return nullptr;
+  }
+  Block* block = findSuitableBlock(fl, sl);
+  if(block == nullptr)
+  {
+    return nullptr;
+  }
+  removeFreeBlock(block);
+  block->setFree(false);
+  block->nextPhys()->setPrevFree(false);
+  trimUsedBlock(block, size);
+  if(freeBytes_ < minFreeBytes_) { minFreeBytes_ = freeBytes_; }
+  return block->payload();
+}
+
+bool TlsfHeap::resizeInPlace(void* ptr, size_t size) noexcept
+{
+  if(size == 0 || size > maxPoolSize_Bytes)
+  {
+    return false;
+  }
+  size = adjustRequest(size);
+  Block* block = blockFromPayload(ptr);
+  if(size > block->size())
+  {
+    //Growing requires absorbing the following block, which must be free and large enough.
+    Block* next = block->nextPhys();
+    if(!next->isFree() || (block->size() + headerSize_Bytes + next->size()) < size)
+    {
+      return false;
+    }
+    removeFreeBlock(next);
+    block->setSize(block->size() + headerSize_Bytes + next->size());
+    next = block->nextPhys();
+    next->prevPhys = block;
+    next->setPrevFree(false);
+  }
+  trimUsedBlock(block, size);
+  if(freeBytes_ < minFreeBytes_) { minFreeBytes_ = freeBytes_; }
+  return true;
+}
+
+void TlsfHeap::deallocate(void* ptr) noexcept
+{
+  if(ptr == nullptr)
+  {
+    return;
+  }
+  Block* block = blockFromPayload(ptr);
+  assert(!block->isFree());
+  //Merge with the physically previous and next blocks when they are free.
+  if(block->isPrevFree())
+  {
+    Block* prev = block->prevPhys;
+    removeFreeBlock(prev);
+    prev->setSize(prev->size() + headerSize_Bytes + block->size());
+    block = prev;
+  }
+  Block* next = block->nextPhys();
+  if(next->isFree())
+  {
+    removeFreeBlock(next);
+    block->setSize(block->size() + headerSize_Bytes + next->size());
+    next = block->nextPhys();
+  }
+  next->prevPhys = block;
+  next->setPrevFree(true);
+  block->setFree(true);
+  insertFreeBlock(block);
+}
+
+size_t TlsfHeap::largestFreeBlock_Bytes() const noexcept
+{
+  //The largest block is in the highest non-empty list, but blocks within a list span a range of
+  //sizes, so that single list is walked to find the exact value.
+  if(flBitmap_ == 0)
+  {
+    return 0;
+  }
+  size_t fl = findLastSet(flBitmap_);
+  size_t sl = findLastSet(slBitmap_[fl]);
+  size_t largest = 0;
+  for(const Block* b = freeLists_[fl][sl]; b != nullptr; b = b->nextFree)
+  {
+    if(b->size() > largest) { largest = b->size(); }
+  }
+  return largest;
+}
+
+size_t TlsfHeap::usableSize(const void* ptr) noexcept
+{
+  return blockFromPayload(ptr)->size();
+}
+
+#ifdef TARGET_SUPPORTS_CPPUTEST
+TEST_GROUP(JEL_TestGroup_TlsfHeap)
+{
+  static constexpr size_t poolSize_Bytes = 8192;
+  uint8_t* pool;
+  TlsfHeap* heap;
+  void setup()
+  {
+    pool = new uint8_t[poolSize_Bytes];
+    heap = new TlsfHeap(pool, poolSize_Bytes);
+  }
+  void teardown()
+  {
+    delete heap;
+    delete[] pool;
+  }
+};
+TEST(JEL_TestGroup_TlsfHeap, AllocateAndCoalesce)
+{
+  const size_t initialFree = heap->freeSpace_Bytes();
+  CHECK(initialFree > 0 && initialFree < poolSize_Bytes);
+  CHECK(heap->largestFreeBlock_Bytes() == initialFree);
+  void* a = heap->allocate(100);
+  void* b = heap->allocate(1);
+  void* c = heap->allocate(1000);
+  CHECK(a && b && c);
+  CHECK((reinterpret_cast<uintptr_t>(a) % TlsfHeap::alignment_Bytes) == 0);
+  CHECK(TlsfHeap::usableSize(a) >= 100);
+  CHECK(heap->freeSpace_Bytes() < initialFree);
+  //Freeing the middle block must not merge it with its allocated neighbours.
+  heap->deallocate(b);
+  CHECK(heap->largestFreeBlock_Bytes() < heap->freeSpace_Bytes());
+  //Freeing the outer blocks must merge everything back into a single free block.
+  heap->deallocate(a);
+  heap->deallocate(c);
+  CHECK(heap->freeSpace_Bytes() == initialFree);
+  CHECK(heap->largestFreeBlock_Bytes() == initialFree);
+  CHECK(heap->minimumFreeSpace_Bytes() < initialFree);
+}
+TEST(JEL_TestGroup_TlsfHeap, ResizeInPlace)
+{
+  const size_t initialFree = heap->freeSpace_Bytes();
+  uint8_t* a = static_cast<uint8_t*>(heap->allocate(64));
+  uint8_t* b = static_cast<uint8_t*>(heap->allocate(64));
+  CHECK(a && b);
+  //b is followed by the remainder of the pool, so it can grow and shrink in place.
+  CHECK(heap->resizeInPlace(b, 1024));
+  CHECK(TlsfHeap::usableSize(b) >= 1024);
+  CHECK(heap->resizeInPlace(b, 32));
+  CHECK(TlsfHeap::usableSize(b) < 64);
+  //a is followed by the allocated block b, and so cannot grow.
+  CHECK(!heap->resizeInPlace(a, 128));
+  CHECK(heap->resizeInPlace(a, 8));
+  heap->deallocate(a);
+  heap->deallocate(b);
+  CHECK(heap->freeSpace_Bytes() == initialFree);
+  CHECK(heap->largestFreeBlock_Bytes() == initialFree);
+}
+TEST(JEL_TestGroup_TlsfHeap, Exhaustion)
+{
+  CHECK(heap->allocate(0) == nullptr);
+  CHECK(heap->allocate(poolSize_Bytes) == nullptr);
+  //Each allocation costs at least its payload plus a two word block header, which bounds the
+  //number that can fit. The extra slot receives the failing allocation.
+  constexpr size_t maxAllocations = poolSize_Bytes / (16 + 2 * sizeof(void*)) + 1;
+  void* ptrs[maxAllocations];
+  size_t count = 0;
+  while((ptrs[count] = heap->allocate(16)) != nullptr)
+  {
+    count++;
+    if(count == maxAllocations) { break; }
+  }
+  CHECK(count > 0 && count < maxAllocations);
+  CHECK(heap->largestFreeBlock_Bytes() < 16);
+  for(size_t i = 0; i < count; i += 2)
+  {
+    heap->deallocate(ptrs[i]);
+  }
+  //Half the heap is free, but only as isolated holes.
+  CHECK(heap->largestFreeBlock_Bytes() * 4 < heap->freeSpace_Bytes());
+  for(size_t i = 1; i < count; i += 2)
+  {
+    heap->deallocate(ptrs[i]);
+  }
+  CHECK(heap->largestFreeBlock_Bytes() == heap->freeSpace_Bytes());
+}
+TEST(JEL_TestGroup_TlsfHeap, LatencyIndependentOfFragmentation)
+{
+  //Time allocate/free pairs on an empty heap, then again once the heap is split into many small
+  //free holes. A list walking heap slows down in the second case; the TLSF heap should not.
+  constexpr size_t iterations = 500;
+  auto timePairs = [&]() -> Duration
+  {
+    Timestamp start = SteadyClock::now();
+    for(size_t i = 0; i < iterations; i++)
+    {
+      heap->deallocate(heap->allocate(256));
+    }
+    return SteadyClock::now() - start;
+  };
+  Duration baseline = timePairs();
+  void* ptrs[poolSize_Bytes / 64];
+  size_t count = 0;
+  while(count < (poolSize_Bytes / 64) - 8 && (ptrs[count] = heap->allocate(24)) != nullptr)
+  {
+    count++;
+  }
+  for(size_t i = 0; i < count; i += 2)
+  {
+    heap->deallocate(ptrs[i]);
+  }
+  Duration fragmented = timePairs();
+  UT_PRINT(StringFromFormat("TLSF alloc/free x%u: %lldus empty, %lldus with %u free holes.",
+    iterations, baseline.toMicroseconds(), fragmented.toMicroseconds(), count / 2).asCharString());
+  CHECK(fragmented <= baseline + baseline / 4 + Duration::microseconds(50));
+  for(size_t i = 1; i < count; i += 2)
+  {
+    heap->deallocate(ptrs[i]);
+  }
+}
+#endif
+
+} /** namespace jel */
@@ -0,0 +1,155 @@
+/** @file os/internal/tlsf.hpp
+ *  @brief A Two-Level Segregated Fit (TLSF) heap, used as the system heap implementation.
+ *
+ *  @detail
+ *    The TLSF heap provides O(1) allocation and deallocation from one contiguous memory region.
+ *    Free blocks are kept in a two dimensional array of segregated free lists. The first level
+ *    splits free blocks by power of two size classes, and the second level linearly subdivides each
+ *    power of two into slCount ranges. A pair of bitmaps records which lists are non-empty, so a
+ *    suitable free block is always found with two find-first-set operations instead of walking a
+ *    free list. Freed blocks are immediately coalesced with their physical neighbours.
+ *
+ *    Every block is preceded by a small header holding a pointer to the physically previous block
+ *    and the block size; the two low bits of the size store the free and previous-free flags.
+ *    Free blocks reuse their payload to store the free list links.
+ *
+ *    The TlsfHeap is *not* threadsafe. Users (i.e. the SystemAllocator) are responsible for
+ *    locking.
+ *    This header should not be included by any application files, only jel os files.
+ *
+ *  @author Jonathan Thomson
+ */
+/**
+ * MIT License
+ *
+ * Copyright 2018, Jonathan Thomson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+/** C/C++ Standard Library Headers */
+#include <cstdint>
+#include <cstddef>
+/** jel Library Headers */
+
+namespace jel
+{
+
+class TlsfHeap
+{
+public:
+  /** All returned pointers and block sizes are aligned to this boundary. */
+  static constexpr size_t alignment_Bytes = 8;
+  /** Construct a heap that manages the memory region [pool, pool + size). The region must remain
+   * valid for the lifetime of the heap. Regions larger than maxPoolSize_Bytes are truncated. */
+  TlsfHeap(void* pool, size_t size) noexcept;
+  TlsfHeap(const TlsfHeap&) = delete;
+  TlsfHeap& operator=(const TlsfHeap&) = delete;
+  /** Returns a pointer to at least size bytes, or a nullptr if no suitable free block exists. */
+  void* allocate(size_t size) noexcept;
+  /** Attempts to resize an allocated block to at least size bytes without moving it. Shrinking
+   * always succeeds; growing succeeds only if the physically following block is free and large
+   * enough. Returns false (leaving the block untouched) if the block must be moved. */
+  bool resizeInPlace(void* ptr, size_t size) noexcept;
+  /** Releases memory returned by allocate(). A nullptr is ignored. */
+  void deallocate(void* ptr) noexcept;
+  /** Total bytes available to allocations, across all free blocks. */
+  size_t freeSpace_Bytes() const noexcept { return freeBytes_; }
+  /** The lowest value freeSpace_Bytes() has ever reported. */
+  size_t minimumFreeSpace_Bytes() const noexcept { return minFreeBytes_; }
+  /** Total size of the managed region, including all block headers. */
+  size_t totalSpace_Bytes() const noexcept { return poolSize_; }
+  /** The largest single allocation that can currently succeed. */
+  size_t largestFreeBlock_Bytes() const noexcept;
+  /** Returns the usable size of an allocated block. This may be larger than the requested size. */
+  static size_t usableSize(const void* ptr) noexcept;
+private:
+  struct Block
+  {
+    /** The block physically preceding this one, or a nullptr for the first block in the pool. */
+    Block* prevPhys;
+    /** Payload size in bytes. The two low bits are used for the freeBit and prevFreeBit flags. */
+    size_t sizeAndFlags;
+    /** Free list links. These are only valid while the block is free, and occupy the payload. */
+    Block* nextFree;
+    Block* prevFree;
+    size_t size() const noexcept { return sizeAndFlags & ~flagMask; }
+    void setSize(size_t sz) noexcept { sizeAndFlags = sz | (sizeAndFlags & flagMask); }
+    bool isFree() const noexcept { return sizeAndFlags & freeBit; }
+    void setFree(bool f) noexcept
+    {
+      sizeAndFlags = f ? sizeAndFlags | freeBit : sizeAndFlags & ~freeBit;
+    }
+    bool isPrevFree() const noexcept { return sizeAndFlags & prevFreeBit; }
+    void setPrevFree(bool f) noexcept
+    {
+      sizeAndFlags = f ? sizeAndFlags | prevFreeBit : sizeAndFlags & ~prevFreeBit;
+    }
+    void* payload() noexcept { return reinterpret_cast<uint8_t*>(this) + headerSize_Bytes; }
+    Block* nextPhys() noexcept
+    {
+      return reinterpret_cast<Block*>(reinterpret_cast<uint8_t*>(payload()) + size());
+    }
+  };
+  static constexpr size_t freeBit = 0x1;
+  static constexpr size_t prevFreeBit = 0x2;
+  static constexpr size_t flagMask = freeBit | prevFreeBit;
+  /** Bytes of overhead for an allocated block. The free list links are only present when free. */
+  static constexpr size_t headerSize_Bytes = offsetof(Block, nextFree);
+  static constexpr size_t minimumBlockSize_Bytes = sizeof(Block) - headerSize_Bytes;
+  static constexpr size_t slIndexCountLog2 = 4;
+  static constexpr size_t slCount = 1 << slIndexCountLog2;
+  static constexpr size_t alignmentLog2 = 3;
+  /** The first level index that holds all blocks smaller than smallBlockSize_Bytes. Blocks below
+   * this size are split linearly into slCount lists of alignment_Bytes granularity. */
+  static constexpr size_t flIndexShift = slIndexCountLog2 + alignmentLog2;
+  static constexpr size_t smallBlockSize_Bytes = 1 << flIndexShift;
+  /** Blocks must be smaller than 2^flIndexMax bytes (4MiB). */
+  static constexpr size_t flIndexMax = 22;
+  static constexpr size_t flCount = flIndexMax - flIndexShift + 1;
+  static constexpr size_t maxPoolSize_Bytes = (static_cast<size_t>(1) << flIndexMax);
+  static_assert((1u << alignmentLog2) == alignment_Bytes, "Alignment log2 mismatch.");
+  static_assert(headerSize_Bytes % alignment_Bytes == 0,
+    "Block headers must preserve payload alignment.");
+  static_assert(minimumBlockSize_Bytes <= alignment_Bytes * 2, "Unexpected free block overhead.");
+  static_assert(flCount <= 32 && slCount <= 32, "Bitmaps must fit into a single word.");
+
+  uint32_t flBitmap_;
+  uint32_t slBitmap_[flCount];
+  Block* freeLists_[flCount][slCount];
+  size_t poolSize_;
+  size_t freeBytes_;
+  size_t minFreeBytes_;
+
+  static size_t findLastSet(uint32_t word) noexcept { return 31 - __builtin_clz(word); }
+  static size_t findFirstSet(uint32_t word) noexcept { return __builtin_ctz(word); }
+  /** Calculate the free list index that a block of the given size belongs in. */
+  static void mapInsert(size_t size, size_t& fl, size_t& sl) noexcept;
+  /** Calculate the first free list index in which every block is guaranteed to fit size bytes. */
+  static void mapSearch(size_t size, size_t& fl, size_t& sl) noexcept;
+  static Block* blockFromPayload(const void* ptr) noexcept;
+  /** Round a request up to a valid block size. */
+  static size_t adjustRequest(size_t size) noexcept;
+  Block* findSuitableBlock(size_t& fl, size_t& sl) noexcept;
+  void insertFreeBlock(Block* block) noexcept;
+  void removeFreeBlock(Block* block) noexcept;
+  /** Trims block down to size bytes, returning any usable remainder to the free lists. */
+  void trimUsedBlock(Block* block, size_t size) noexcept;
+};
+
+} /** namespace jel */